@@ -0,0 +1,1551 @@
+/*
+ * cpu.cpp
+ *
+ * Cycle-accurate model of the bus cycles of the 65C02
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "cpu.h"
+#include <cstdio>
+#include <cstring>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Vector of BRK and IRQ
+#define VECTOR_IRQ          (0xFFFE)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Operations, in groups that have the same bus cycles
+enum Operation
+{
+    // Read the operand
+    OP_ADC,
+    OP_AND,
+    OP_BIT,
+    OP_CMP,
+    OP_CPX,
+    OP_CPY,
+    OP_EOR,
+    OP_LDA,
+    OP_LDX,
+    OP_LDY,
+    OP_ORA,
+    OP_SBC,
+
+    // Write the operand
+    OP_STA,
+    OP_STX,
+    OP_STY,
+    OP_STZ,
+
+    // Read, modify and write the operand, or the accumulator
+    OP_ASL,
+    OP_DEC,
+    OP_INC,
+    OP_LSR,
+    OP_RMB,
+    OP_ROL,
+    OP_ROR,
+    OP_SMB,
+    OP_TRB,
+    OP_TSB,
+
+    // Implied
+    OP_CLC,
+    OP_CLD,
+    OP_CLI,
+    OP_CLV,
+    OP_DEX,
+    OP_DEY,
+    OP_INX,
+    OP_INY,
+    OP_SEC,
+    OP_SED,
+    OP_SEI,
+    OP_TAX,
+    OP_TAY,
+    OP_TSX,
+    OP_TXA,
+    OP_TXS,
+    OP_TYA,
+
+    // Stack
+    OP_PHA,
+    OP_PHP,
+    OP_PHX,
+    OP_PHY,
+    OP_PLA,
+    OP_PLP,
+    OP_PLX,
+    OP_PLY,
+
+    // Branches
+    OP_BCC,
+    OP_BCS,
+    OP_BEQ,
+    OP_BMI,
+    OP_BNE,
+    OP_BPL,
+    OP_BRA,
+    OP_BVC,
+    OP_BVS,
+    OP_BBR,
+    OP_BBS,
+
+    // Other
+    OP_BRK,
+    OP_JMP,
+    OP_JSR,
+    OP_NOP,
+    OP_RTI,
+    OP_RTS,
+    OP_STP,
+    OP_WAI,
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DATA
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Operations by mnemonic; BBR, BBS, RMB and SMB have the bit number as
+// fourth character
+static const struct
+{
+    const char *mnemonic;
+    uint8_t     operation;
+}   s_mnemonics[] =
+{
+    { "ADC", OP_ADC }, { "AND", OP_AND }, { "BIT", OP_BIT }, { "CMP", OP_CMP },
+    { "CPX", OP_CPX }, { "CPY", OP_CPY }, { "EOR", OP_EOR }, { "LDA", OP_LDA },
+    { "LDX", OP_LDX }, { "LDY", OP_LDY }, { "ORA", OP_ORA }, { "SBC", OP_SBC },
+    { "STA", OP_STA }, { "STX", OP_STX }, { "STY", OP_STY }, { "STZ", OP_STZ },
+    { "ASL", OP_ASL }, { "DEC", OP_DEC }, { "INC", OP_INC }, { "LSR", OP_LSR },
+    { "RMB", OP_RMB }, { "ROL", OP_ROL }, { "ROR", OP_ROR }, { "SMB", OP_SMB },
+    { "TRB", OP_TRB }, { "TSB", OP_TSB }, { "CLC", OP_CLC }, { "CLD", OP_CLD },
+    { "CLI", OP_CLI }, { "CLV", OP_CLV }, { "DEX", OP_DEX }, { "DEY", OP_DEY },
+    { "INX", OP_INX }, { "INY", OP_INY }, { "SEC", OP_SEC }, { "SED", OP_SED },
+    { "SEI", OP_SEI }, { "TAX", OP_TAX }, { "TAY", OP_TAY }, { "TSX", OP_TSX },
+    { "TXA", OP_TXA }, { "TXS", OP_TXS }, { "TYA", OP_TYA }, { "PHA", OP_PHA },
+    { "PHP", OP_PHP }, { "PHX", OP_PHX }, { "PHY", OP_PHY }, { "PLA", OP_PLA },
+    { "PLP", OP_PLP }, { "PLX", OP_PLX }, { "PLY", OP_PLY }, { "BCC", OP_BCC },
+    { "BCS", OP_BCS }, { "BEQ", OP_BEQ }, { "BMI", OP_BMI }, { "BNE", OP_BNE },
+    { "BPL", OP_BPL }, { "BRA", OP_BRA }, { "BVC", OP_BVC }, { "BVS", OP_BVS },
+    { "BBR", OP_BBR }, { "BBS", OP_BBS }, { "BRK", OP_BRK }, { "JMP", OP_JMP },
+    { "JSR", OP_JSR }, { "NOP", OP_NOP }, { "RTI", OP_RTI }, { "RTS", OP_RTS },
+    { "STP", OP_STP }, { "WAI", OP_WAI },
+};
+
+// Operation of each opcode, filled from the opcode table
+static uint8_t s_operations[256];
+static bool s_initialized;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+Cpu65C02::Cpu65C02()
+    : m_bus(NULL)
+    , m_learn(NULL)
+    , m_learnBase(0)
+{
+    if (!s_initialized)
+    {
+        for (unsigned op = 0; op < 256; op++)
+        {
+            s_operations[op] = OP_NOP;
+
+            for (unsigned u = 0; u < sizeof(s_mnemonics) / sizeof(s_mnemonics[0]); u++)
+            {
+                if (!strncmp(g_opcodes[op].mnemonic, s_mnemonics[u].mnemonic, 3))
+                {
+                    s_operations[op] = s_mnemonics[u].operation;
+                    break;
+                }
+            }
+        }
+
+        s_initialized = true;
+    }
+
+    Unknown(0);
+}
+
+
+//---------------------------------------------------------------------------
+// Set the registers as they are after a reset
+//
+// The reset sequence sets the I flag and clears the D flag; the other
+// registers keep their values, so they're unknown. The stack pointer is
+// decremented three times, so it can be known from the trace.
+void Cpu65C02::Reset(
+    uint16_t pc,
+    CpuValue s)
+{
+    Unknown(pc);
+
+    m_s = s;
+    SetFlag(CPU_FLAG_I, true);
+    SetFlag(CPU_FLAG_D, false);
+}
+
+
+//---------------------------------------------------------------------------
+// Forget all registers
+void Cpu65C02::Unknown(
+    uint16_t pc)
+{
+    m_a.value = m_x.value = m_y.value = m_s.value = 0;
+    m_a.known = m_x.known = m_y.known = m_s.known = false;
+    m_p = 0;
+    m_pKnown = 0;
+    m_pc = pc;
+    m_instrPC = pc;
+    memset(m_bytes, 0, sizeof(m_bytes));
+    m_waiting = false;
+    m_stopped = false;
+}
+
+
+//---------------------------------------------------------------------------
+// Run a bus cycle
+//
+// If the address depends on an index register that's unknown, the index is
+// learned from the actual address.
+bool Cpu65C02::Bus(
+    CpuAccess access,
+    uint16_t &addr,
+    uint16_t mask,
+    CpuValue &data)
+{
+    if (!m_bus->Access(access, addr, mask, data))
+    {
+        return false;
+    }
+
+    if (m_learn && (access != CPU_DUMMY) && (mask != 0xFFFF))
+    {
+        m_learn->value = (uint8_t)(addr - m_learnBase);
+        m_learn->known = true;
+        m_learn = NULL;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Read the opcode or an operand byte
+bool Cpu65C02::Fetch(
+    unsigned offset,
+    CpuValue &data)
+{
+    uint16_t addr = (uint16_t)(m_pc + offset);
+
+    if (!Bus(CPU_READ, addr, 0xFFFF, data))
+    {
+        return false;
+    }
+
+    if (offset < sizeof(m_bytes))
+    {
+        m_bytes[offset] = data.value;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Run a dummy read cycle
+bool Cpu65C02::Dummy(
+    uint16_t addr)
+{
+    CpuValue data;
+
+    return Bus(CPU_DUMMY, addr, 0, data);
+}
+
+
+//---------------------------------------------------------------------------
+// Push a byte on the stack
+//
+// The data is replaced by the actual data on the bus.
+bool Cpu65C02::Push(
+    CpuValue &data)
+{
+    uint16_t addr = (uint16_t)(0x0100 | m_s.value);
+
+    if (!Bus(CPU_WRITE, addr, m_s.known ? 0xFFFF : 0xFF00, data))
+    {
+        return false;
+    }
+
+    m_s.value = (uint8_t)(addr - 1);
+    m_s.known = true;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Pull a byte from the stack
+bool Cpu65C02::Pull(
+    CpuValue &data)
+{
+    uint16_t addr = (uint16_t)(0x0100 | (uint8_t)(m_s.value + 1));
+
+    if (!Bus(CPU_READ, addr, m_s.known ? 0xFFFF : 0xFF00, data))
+    {
+        return false;
+    }
+
+    m_s.value = (uint8_t)addr;
+    m_s.known = true;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Push the program counter, high byte first
+bool Cpu65C02::PushPC(
+    uint16_t pc)
+{
+    CpuValue hi = { (uint8_t)(pc >> 8), true };
+    CpuValue lo = { (uint8_t)pc, true };
+
+    return Push(hi) && Push(lo);
+}
+
+
+//---------------------------------------------------------------------------
+// Push the processor status, for PHP, BRK and interrupts
+//
+// If some flags are unknown, they're learned from the bus.
+bool Cpu65C02::PushStatus(
+    bool brk)
+{
+    CpuValue data;
+
+    data.value = (uint8_t)(m_p | CPU_FLAG_1 | (brk ? CPU_FLAG_B : 0));
+    data.known = ((m_pKnown & CPU_FLAGS) == CPU_FLAGS);
+
+    if (!Push(data))
+    {
+        return false;
+    }
+
+    m_p = data.value & CPU_FLAGS;
+    m_pKnown = CPU_FLAGS;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Run the cycles of an instruction up to the access of its operand
+//
+// The number of cycles after the operand address is known is used when an
+// unknown index register may or may not cause a page crossing; it's 0 if
+// that isn't known because of the decimal cycle of ADC and SBC.
+bool Cpu65C02::Address(
+    const OpcodeInfo &info,
+    unsigned after,
+    uint16_t &ea,
+    uint16_t &mask)
+{
+    CpuValue lo;
+    CpuValue hi;
+    CpuValue &index = ((info.mode == MODE_ZPY) || (info.mode == MODE_ABY)
+        || (info.mode == MODE_IZY)) ? m_y : m_x;
+    uint16_t ptr;
+
+    mask = 0xFFFF;
+
+    switch (info.mode)
+    {
+    case MODE_ZP:
+        if (!Fetch(1, lo))
+        {
+            return false;
+        }
+
+        ea = lo.value;
+        return true;
+
+    case MODE_ZPX:
+    case MODE_ZPY:
+        if (!Fetch(1, lo) || !Dummy((uint16_t)(m_pc + 1)))
+        {
+            return false;
+        }
+
+        ea = (uint8_t)(lo.value + index.value);
+        if (!index.known)
+        {
+            // The address stays in the zero page
+            mask = 0xFF00;
+            m_learn = &index;
+            m_learnBase = lo.value;
+        }
+
+        return true;
+
+    case MODE_ABS:
+        if (!Fetch(1, lo) || !Fetch(2, hi))
+        {
+            return false;
+        }
+
+        ea = (uint16_t)(lo.value | (hi.value << 8));
+        return true;
+
+    case MODE_ABX:
+    case MODE_ABY:
+        if (!Fetch(1, lo) || !Fetch(2, hi))
+        {
+            return false;
+        }
+
+        return Indexed((uint16_t)(lo.value | (hi.value << 8)), index, info,
+            after, ea, mask);
+
+    case MODE_IZX:
+        if (!Fetch(1, lo) || !Dummy((uint16_t)(m_pc + 1)))
+        {
+            return false;
+        }
+
+        ptr = (uint8_t)(lo.value + index.value);
+        if (!index.known)
+        {
+            m_learn = &index;
+            m_learnBase = lo.value;
+        }
+
+        if (!Bus(CPU_READ, ptr, index.known ? 0xFFFF : 0xFF00, lo))
+        {
+            return false;
+        }
+
+        ptr = (uint8_t)(ptr + 1);
+        if (!Bus(CPU_READ, ptr, 0xFFFF, hi))
+        {
+            return false;
+        }
+
+        ea = (uint16_t)(lo.value | (hi.value << 8));
+        return true;
+
+    case MODE_IZY:
+    case MODE_IZP:
+        if (!Fetch(1, lo))
+        {
+            return false;
+        }
+
+        ptr = lo.value;
+        if (!Bus(CPU_READ, ptr, 0xFFFF, lo))
+        {
+            return false;
+        }
+
+        ptr = (uint8_t)(ptr + 1);
+        if (!Bus(CPU_READ, ptr, 0xFFFF, hi))
+        {
+            return false;
+        }
+
+        ea = (uint16_t)(lo.value | (hi.value << 8));
+        if (info.mode == MODE_IZY)
+        {
+            return Indexed(ea, index, info, after, ea, mask);
+        }
+
+        return true;
+
+    default:
+        ea = 0;
+        return true;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Add an index register to a base address
+//
+// The table has no extra cycle for instructions that always take the extra
+// cycle (stores and INC/DEC); for the others, it's only there if the
+// page is crossed. If the index is unknown, the number of cycles that are
+// left in the instruction shows whether the extra cycle is there.
+//
+// If the D flag is unknown too, one more cycle in ADC or SBC can be the
+// page crossing or decimal mode. On a page crossing, the last operand byte
+// is read again and then the operand in the next page; in decimal mode,
+// the operand in the same page is read and then the last operand byte.
+// If the addresses of those cycles don't tell, the index stays unknown.
+bool Cpu65C02::Indexed(
+    uint16_t base,
+    CpuValue &index,
+    const OpcodeInfo &info,
+    unsigned after,
+    uint16_t &ea,
+    uint16_t &mask)
+{
+    bool dummy = !info.extra;
+    uint16_t last = (uint16_t)(m_pc + info.len - 1);
+    unsigned cycles;
+
+    ea = (uint16_t)(base + index.value);
+
+    if (index.known)
+    {
+        dummy = dummy || ((ea ^ base) & 0xFF00);
+    }
+    else
+    {
+        mask = 0;
+        m_learn = &index;
+        m_learnBase = base;
+
+        if (!dummy && m_bus->Remaining(cycles))
+        {
+            if (after || (cycles != 2))
+            {
+                dummy = (cycles > (after ? after : 1));
+            }
+            else
+            {
+                uint16_t first;
+                uint16_t second;
+                bool seen = m_bus->Peek(0, first) && m_bus->Peek(1, second);
+
+                if (seen && (first == last)
+                    && ((uint8_t)((second >> 8) - (base >> 8)) == 1))
+                {
+                    dummy = true;
+                }
+                else if (!seen || ((first ^ base) & 0xFF00)
+                    || (second != last))
+                {
+                    // Can't tell which; don't learn a wrong index
+                    m_learn = NULL;
+                }
+            }
+        }
+    }
+
+    // The 65C02 reads the last operand byte again
+    return !dummy || Dummy(last);
+}
+
+
+//---------------------------------------------------------------------------
+// Check for decimal mode in ADC and SBC, and run the extra cycle
+//
+// If the D flag is unknown, the number of cycles that are left shows
+// whether it's set.
+bool Cpu65C02::Decimal(
+    const OpcodeInfo &info,
+    bool &decimal,
+    bool &known)
+{
+    unsigned cycles;
+
+    known = Flag(CPU_FLAG_D, decimal);
+    if (!known && m_bus->Remaining(cycles))
+    {
+        decimal = (cycles != 0);
+        SetFlag(CPU_FLAG_D, decimal);
+        known = true;
+    }
+
+    return !decimal || Dummy((uint16_t)(m_pc + info.len - 1));
+}
+
+
+//---------------------------------------------------------------------------
+// Set or clear a flag
+void Cpu65C02::SetFlag(
+    uint8_t flag,
+    bool set)
+{
+    m_p = (uint8_t)(set ? (m_p | flag) : (m_p & ~flag));
+    m_pKnown |= flag;
+}
+
+
+//---------------------------------------------------------------------------
+// Make flags unknown
+void Cpu65C02::Forget(
+    uint8_t flags)
+{
+    m_pKnown &= (uint8_t)~flags;
+}
+
+
+//---------------------------------------------------------------------------
+// Get a flag
+bool                                    // Returns false if unknown
+Cpu65C02::Flag(
+    uint8_t flag,
+    bool &set) const
+{
+    set = (m_p & flag) != 0;
+
+    return (m_pKnown & flag) != 0;
+}
+
+
+//---------------------------------------------------------------------------
+// Set the N and Z flags from a value
+void Cpu65C02::SetNZ(
+    CpuValue v)
+{
+    if (v.known)
+    {
+        SetFlag(CPU_FLAG_N, (v.value & 0x80) != 0);
+        SetFlag(CPU_FLAG_Z, !v.value);
+    }
+    else
+    {
+        Forget(CPU_FLAG_N | CPU_FLAG_Z);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Load a register and set the N and Z flags
+void Cpu65C02::Load(
+    CpuValue &reg,
+    CpuValue v)
+{
+    reg = v;
+    SetNZ(v);
+}
+
+
+//---------------------------------------------------------------------------
+// ADC
+//
+// In decimal mode, the result and the carry are computed as in sequence 1
+// of Bruce Clark's "Decimal Mode" tutorial, and V as in sequence 2. The
+// 65C02 sets N and Z from the decimal result.
+void Cpu65C02::Add(
+    uint8_t m,
+    bool decimal)
+{
+    unsigned a = m_a.value;
+    unsigned c = (m_p & CPU_FLAG_C) ? 1 : 0;
+    unsigned r = a + m + c;
+    bool v = (~(a ^ m) & (a ^ r) & 0x80) != 0;
+
+    if (decimal)
+    {
+        unsigned lo = (a & 0x0F) + (m & 0x0F) + c;
+
+        if (lo >= 0x0A)
+        {
+            lo = ((lo + 0x06) & 0x0F) + 0x10;
+        }
+
+        r = (a & 0xF0) + (m & 0xF0) + lo;
+
+        int s = (int8_t)(a & 0xF0) + (int8_t)(m & 0xF0) + (int)lo;
+
+        v = (s < -128) || (s > 127);
+
+        if (r >= 0xA0)
+        {
+            r += 0x60;
+        }
+    }
+
+    CpuValue result = { (uint8_t)r, true };
+
+    SetFlag(CPU_FLAG_C, r >= 0x100);
+    SetFlag(CPU_FLAG_V, v);
+    Load(m_a, result);
+}
+
+
+//---------------------------------------------------------------------------
+// SBC
+//
+// In decimal mode, the result is computed as in sequence 3 of Bruce
+// Clark's tutorial; C and V are the same as in binary mode.
+void Cpu65C02::Subtract(
+    uint8_t m,
+    bool decimal)
+{
+    int a = m_a.value;
+    int c = (m_p & CPU_FLAG_C) ? 1 : 0;
+    int r = a - m + c - 1;
+    bool v = ((a ^ m) & (a ^ r) & 0x80) != 0;
+
+    SetFlag(CPU_FLAG_C, r >= 0);
+    SetFlag(CPU_FLAG_V, v);
+
+    if (decimal)
+    {
+        int lo = (a & 0x0F) - (m & 0x0F) + c - 1;
+
+        if (r < 0)
+        {
+            r -= 0x60;
+        }
+
+        if (lo < 0)
+        {
+            r -= 0x06;
+        }
+    }
+
+    CpuValue result = { (uint8_t)r, true };
+
+    Load(m_a, result);
+}
+
+
+//---------------------------------------------------------------------------
+// CMP, CPX and CPY
+void Cpu65C02::Compare(
+    CpuValue reg,
+    uint8_t m)
+{
+    CpuValue r = { (uint8_t)(reg.value - m), reg.known };
+
+    if (reg.known)
+    {
+        SetFlag(CPU_FLAG_C, reg.value >= m);
+    }
+    else
+    {
+        Forget(CPU_FLAG_C);
+    }
+
+    SetNZ(r);
+}
+
+
+//---------------------------------------------------------------------------
+// Compute the result of a read-modify-write operation
+CpuValue Cpu65C02::Modify(
+    unsigned operation,
+    uint8_t opcode,
+    CpuValue m)
+{
+    CpuValue r = m;
+    uint8_t bit = (uint8_t)(1 << ((opcode >> 4) & 7));
+    bool c = false;
+
+    switch (operation)
+    {
+    case OP_ASL:
+    case OP_ROL:
+        r.value = (uint8_t)(m.value << 1);
+        if (operation == OP_ROL)
+        {
+            r.known = m.known && Flag(CPU_FLAG_C, c);
+            r.value |= (uint8_t)(c ? 1 : 0);
+        }
+
+        if (m.known)
+        {
+            SetFlag(CPU_FLAG_C, (m.value & 0x80) != 0);
+        }
+        else
+        {
+            Forget(CPU_FLAG_C);
+        }
+
+        SetNZ(r);
+        break;
+
+    case OP_LSR:
+    case OP_ROR:
+        r.value = (uint8_t)(m.value >> 1);
+        if (operation == OP_ROR)
+        {
+            r.known = m.known && Flag(CPU_FLAG_C, c);
+            r.value |= (uint8_t)(c ? 0x80 : 0);
+        }
+
+        if (m.known)
+        {
+            SetFlag(CPU_FLAG_C, (m.value & 0x01) != 0);
+        }
+        else
+        {
+            Forget(CPU_FLAG_C);
+        }
+
+        SetNZ(r);
+        break;
+
+    case OP_INC:
+        r.value++;
+        SetNZ(r);
+        break;
+
+    case OP_DEC:
+        r.value--;
+        SetNZ(r);
+        break;
+
+    case OP_TSB:
+    case OP_TRB:
+        r.known = m.known && m_a.known;
+        r.value = (uint8_t)((operation == OP_TSB)
+            ? (m.value | m_a.value) : (m.value & ~m_a.value));
+
+        if (r.known)
+        {
+            SetFlag(CPU_FLAG_Z, !(m.value & m_a.value));
+        }
+        else
+        {
+            Forget(CPU_FLAG_Z);
+        }
+        break;
+
+    case OP_RMB:
+        r.value &= (uint8_t)~bit;
+        break;
+
+    case OP_SMB:
+        r.value |= bit;
+        break;
+
+    default:
+        break;
+    }
+
+    return r;
+}
+
+
+//---------------------------------------------------------------------------
+// Instruction that reads its operand
+bool Cpu65C02::Read(
+    unsigned operation,
+    const OpcodeInfo &info)
+{
+    bool arithmetic = (operation == OP_ADC) || (operation == OP_SBC);
+    CpuValue m;
+    uint16_t ea;
+    uint16_t mask;
+    bool decimal = false;
+    bool known = true;
+    bool c;
+
+    if (info.mode == MODE_IMM)
+    {
+        if (!Fetch(1, m))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Count the decimal cycle for an unknown index if D is known
+        unsigned after = !arithmetic ? 1
+            : !Flag(CPU_FLAG_D, decimal) ? 0
+            : decimal ? 2 : 1;
+
+        if (!Address(info, after, ea, mask)
+            || !Bus(CPU_READ, ea, mask, m))
+        {
+            return false;
+        }
+    }
+
+    if (arithmetic && !Decimal(info, decimal, known))
+    {
+        return false;
+    }
+
+    switch (operation)
+    {
+    case OP_ADC:
+    case OP_SBC:
+        if (!known || !m_a.known || !Flag(CPU_FLAG_C, c))
+        {
+            m_a.known = false;
+            Forget(CPU_FLAG_N | CPU_FLAG_V | CPU_FLAG_Z | CPU_FLAG_C);
+        }
+        else if (operation == OP_ADC)
+        {
+            Add(m.value, decimal);
+        }
+        else
+        {
+            Subtract(m.value, decimal);
+        }
+        break;
+
+    case OP_AND:
+    case OP_EOR:
+    case OP_ORA:
+        m_a.value = (uint8_t)((operation == OP_AND) ? (m_a.value & m.value)
+            : (operation == OP_EOR) ? (m_a.value ^ m.value)
+            : (m_a.value | m.value));
+        SetNZ(m_a);
+        break;
+
+    case OP_BIT:
+        if (m_a.known)
+        {
+            SetFlag(CPU_FLAG_Z, !(m_a.value & m.value));
+        }
+        else
+        {
+            Forget(CPU_FLAG_Z);
+        }
+
+        // BIT #imm only changes Z
+        if (info.mode != MODE_IMM)
+        {
+            SetFlag(CPU_FLAG_N, (m.value & 0x80) != 0);
+            SetFlag(CPU_FLAG_V, (m.value & 0x40) != 0);
+        }
+        break;
+
+    case OP_CMP:
+        Compare(m_a, m.value);
+        break;
+
+    case OP_CPX:
+        Compare(m_x, m.value);
+        break;
+
+    case OP_CPY:
+        Compare(m_y, m.value);
+        break;
+
+    case OP_LDA:
+        Load(m_a, m);
+        break;
+
+    case OP_LDX:
+        Load(m_x, m);
+        break;
+
+    case OP_LDY:
+        Load(m_y, m);
+        break;
+
+    default:
+        break;
+    }
+
+    m_pc = (uint16_t)(m_pc + info.len);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Instruction that writes its operand
+//
+// If the register that's stored is unknown, it's learned from the bus.
+bool Cpu65C02::Write(
+    unsigned operation,
+    const OpcodeInfo &info)
+{
+    CpuValue zero = { 0, true };
+    CpuValue &reg = (operation == OP_STA) ? m_a
+        : (operation == OP_STX) ? m_x
+        : (operation == OP_STY) ? m_y : zero;
+    CpuValue data = reg;
+    uint16_t ea;
+    uint16_t mask;
+
+    if (!Address(info, 1, ea, mask) || !Bus(CPU_WRITE, ea, mask, data))
+    {
+        return false;
+    }
+
+    reg = data;
+    m_pc = (uint16_t)(m_pc + info.len);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Instruction that reads, modifies and writes its operand
+//
+// The 65C02 reads the operand twice, where the NMOS 6502 writes it twice.
+bool Cpu65C02::ReadModifyWrite(
+    unsigned operation,
+    const OpcodeInfo &info)
+{
+    CpuValue m;
+    uint16_t ea;
+    uint16_t mask;
+
+    if (info.mode == MODE_ACC)
+    {
+        if (!Dummy((uint16_t)(m_pc + 1)))
+        {
+            return false;
+        }
+
+        m_a = Modify(operation, m_bytes[0], m_a);
+        m_pc = (uint16_t)(m_pc + info.len);
+
+        return true;
+    }
+
+    if (!Address(info, 3, ea, mask)
+        || !Bus(CPU_READ, ea, mask, m)
+        || !Dummy(ea))
+    {
+        return false;
+    }
+
+    m = Modify(operation, m_bytes[0], m);
+
+    if (!Bus(CPU_WRITE, ea, 0xFFFF, m))
+    {
+        return false;
+    }
+
+    m_pc = (uint16_t)(m_pc + info.len);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the condition of a branch on a flag
+//
+// If the flag is unknown, it's learned from the number of cycles that are
+// left: only a branch that's taken has more cycles after the offset.
+bool                                    // Returns true if taken
+Cpu65C02::Condition(
+    uint8_t flag,
+    bool set)
+{
+    bool value;
+    unsigned cycles;
+
+    if (!Flag(flag, value))
+    {
+        if (!m_bus->Remaining(cycles))
+        {
+            return false;
+        }
+
+        value = ((cycles != 0) == set);
+        SetFlag(flag, value);
+    }
+
+    return value == set;
+}
+
+
+//---------------------------------------------------------------------------
+// Finish a branch after the offset was read
+//
+// A branch that's taken has an extra cycle, and one more if the target is
+// in another page.
+bool Cpu65C02::Branch(
+    bool taken,
+    unsigned len)
+{
+    uint16_t next = (uint16_t)(m_pc + len);
+    uint16_t target = (uint16_t)(next + (int8_t)m_bytes[len - 1]);
+
+    if (taken)
+    {
+        if (!Dummy(next))
+        {
+            return false;
+        }
+
+        if (((target ^ next) & 0xFF00) && !Dummy(next))
+        {
+            return false;
+        }
+
+        next = target;
+    }
+
+    m_pc = next;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Execute an instruction
+bool Cpu65C02::Step(
+    CpuBus &bus)
+{
+    CpuValue data;
+    CpuValue lo;
+    CpuValue hi;
+    uint16_t addr;
+    uint16_t mask;
+
+    m_bus = &bus;
+    m_learn = NULL;
+    m_instrPC = m_pc;
+    m_waiting = false;
+    memset(m_bytes, 0, sizeof(m_bytes));
+
+    if (!Fetch(0, data))
+    {
+        return false;
+    }
+
+    const OpcodeInfo &info = g_opcodes[data.value];
+    unsigned operation = s_operations[data.value];
+
+    if (operation <= OP_SBC)
+    {
+        return Read(operation, info);
+    }
+
+    if (operation <= OP_STZ)
+    {
+        return Write(operation, info);
+    }
+
+    if (operation <= OP_TSB)
+    {
+        return ReadModifyWrite(operation, info);
+    }
+
+    if (operation <= OP_TYA)
+    {
+        // Implied instructions read the next byte
+        if (!Dummy((uint16_t)(m_pc + 1)))
+        {
+            return false;
+        }
+
+        switch (operation)
+        {
+        case OP_CLC: SetFlag(CPU_FLAG_C, false); break;
+        case OP_CLD: SetFlag(CPU_FLAG_D, false); break;
+        case OP_CLI: SetFlag(CPU_FLAG_I, false); break;
+        case OP_CLV: SetFlag(CPU_FLAG_V, false); break;
+        case OP_SEC: SetFlag(CPU_FLAG_C, true);  break;
+        case OP_SED: SetFlag(CPU_FLAG_D, true);  break;
+        case OP_SEI: SetFlag(CPU_FLAG_I, true);  break;
+        case OP_DEX: m_x.value--; SetNZ(m_x);    break;
+        case OP_DEY: m_y.value--; SetNZ(m_y);    break;
+        case OP_INX: m_x.value++; SetNZ(m_x);    break;
+        case OP_INY: m_y.value++; SetNZ(m_y);    break;
+        case OP_TAX: Load(m_x, m_a);             break;
+        case OP_TAY: Load(m_y, m_a);             break;
+        case OP_TSX: Load(m_x, m_s);             break;
+        case OP_TXA: Load(m_a, m_x);             break;
+        case OP_TXS: m_s = m_x;                  break;
+        case OP_TYA: Load(m_a, m_y);             break;
+        default:                                 break;
+        }
+
+        m_pc++;
+        return true;
+    }
+
+    if (operation <= OP_PHY)
+    {
+        // Pushing an unknown register gives it away
+        if (!Dummy((uint16_t)(m_pc + 1)))
+        {
+            return false;
+        }
+
+        m_pc++;
+
+        switch (operation)
+        {
+        case OP_PHA: return Push(m_a);
+        case OP_PHX: return Push(m_x);
+        case OP_PHY: return Push(m_y);
+        default:     return PushStatus(true);
+        }
+    }
+
+    if (operation <= OP_PLY)
+    {
+        addr = (uint16_t)(0x0100 | m_s.value);
+        if (!Dummy((uint16_t)(m_pc + 1)) || !Dummy(addr) || !Pull(data))
+        {
+            return false;
+        }
+
+        switch (operation)
+        {
+        case OP_PLA: Load(m_a, data); break;
+        case OP_PLX: Load(m_x, data); break;
+        case OP_PLY: Load(m_y, data); break;
+        default:
+            m_p = data.value & CPU_FLAGS;
+            m_pKnown = CPU_FLAGS;
+            break;
+        }
+
+        m_pc++;
+        return true;
+    }
+
+    if (operation <= OP_BVS)
+    {
+        bool taken = true;
+
+        if (!Fetch(1, data))
+        {
+            return false;
+        }
+
+        switch (operation)
+        {
+        case OP_BCC: taken = Condition(CPU_FLAG_C, false); break;
+        case OP_BCS: taken = Condition(CPU_FLAG_C, true);  break;
+        case OP_BEQ: taken = Condition(CPU_FLAG_Z, true);  break;
+        case OP_BMI: taken = Condition(CPU_FLAG_N, true);  break;
+        case OP_BNE: taken = Condition(CPU_FLAG_Z, false); break;
+        case OP_BPL: taken = Condition(CPU_FLAG_N, false); break;
+        case OP_BVC: taken = Condition(CPU_FLAG_V, false); break;
+        case OP_BVS: taken = Condition(CPU_FLAG_V, true);  break;
+        default:                                           break;
+        }
+
+        return Branch(taken, 2);
+    }
+
+    switch (operation)
+    {
+    case OP_BBR:
+    case OP_BBS:
+        // The zero page location is read twice before the offset
+        if (!Fetch(1, lo))
+        {
+            return false;
+        }
+
+        addr = lo.value;
+        if (!Bus(CPU_READ, addr, 0xFFFF, data) || !Dummy(addr)
+            || !Fetch(2, hi))
+        {
+            return false;
+        }
+
+        return Branch(((data.value >> ((m_bytes[0] >> 4) & 7)) & 1)
+            == ((operation == OP_BBS) ? 1 : 0), 3);
+
+    case OP_BRK:
+        // The byte after the opcode is read and skipped
+        if (!Fetch(1, data) || !PushPC((uint16_t)(m_pc + 2))
+            || !PushStatus(true))
+        {
+            return false;
+        }
+
+        SetFlag(CPU_FLAG_I, true);
+        SetFlag(CPU_FLAG_D, false);
+
+        addr = VECTOR_IRQ;
+        if (!Bus(CPU_READ, addr, 0xFFFF, lo))
+        {
+            return false;
+        }
+
+        addr++;
+        if (!Bus(CPU_READ, addr, 0xFFFF, hi))
+        {
+            return false;
+        }
+
+        m_pc = (uint16_t)(lo.value | (hi.value << 8));
+        return true;
+
+    case OP_JMP:
+        if (!Fetch(1, lo) || !Fetch(2, hi))
+        {
+            return false;
+        }
+
+        addr = (uint16_t)(lo.value | (hi.value << 8));
+        if (info.mode != MODE_ABS)
+        {
+            // JMP (abs) and JMP (abs,X) have an internal cycle before they
+            // read the new program counter
+            mask = 0xFFFF;
+            if (info.mode == MODE_AIX)
+            {
+                if (m_x.known)
+                {
+                    addr = (uint16_t)(addr + m_x.value);
+                }
+                else
+                {
+                    mask = 0;
+                    m_learn = &m_x;
+                    m_learnBase = addr;
+                }
+            }
+
+            if (!Dummy((uint16_t)(m_pc + 2))
+                || !Bus(CPU_READ, addr, mask, lo))
+            {
+                return false;
+            }
+
+            addr++;
+            if (!Bus(CPU_READ, addr, 0xFFFF, hi))
+            {
+                return false;
+            }
+
+            addr = (uint16_t)(lo.value | (hi.value << 8));
+        }
+
+        m_pc = addr;
+        return true;
+
+    case OP_JSR:
+        // The high byte of the target is read after the return address is
+        // pushed; the return address is the address of that byte
+        addr = (uint16_t)(0x0100 | m_s.value);
+        if (!Fetch(1, lo) || !Dummy(addr) || !PushPC((uint16_t)(m_pc + 2))
+            || !Fetch(2, hi))
+        {
+            return false;
+        }
+
+        m_pc = (uint16_t)(lo.value | (hi.value << 8));
+        return true;
+
+    case OP_RTI:
+    case OP_RTS:
+        addr = (uint16_t)(0x0100 | m_s.value);
+        if (!Dummy((uint16_t)(m_pc + 1)) || !Dummy(addr))
+        {
+            return false;
+        }
+
+        if (operation == OP_RTI)
+        {
+            if (!Pull(data))
+            {
+                return false;
+            }
+
+            m_p = data.value & CPU_FLAGS;
+            m_pKnown = CPU_FLAGS;
+        }
+
+        if (!Pull(lo) || !Pull(hi))
+        {
+            return false;
+        }
+
+        m_pc = (uint16_t)(lo.value | (hi.value << 8));
+        if (operation == OP_RTS)
+        {
+            // RTS reads the byte before the next instruction
+            if (!Dummy(m_pc))
+            {
+                return false;
+            }
+
+            m_pc++;
+        }
+
+        return true;
+
+    case OP_STP:
+    case OP_WAI:
+        if (!Dummy((uint16_t)(m_pc + 1)) || !Dummy((uint16_t)(m_pc + 1)))
+        {
+            return false;
+        }
+
+        m_pc++;
+        m_waiting = true;
+        m_stopped = (operation == OP_STP);
+        return true;
+
+    default:
+        // The NOPs read their operand bytes, and use the rest of their
+        // cycles for dummy reads
+        for (unsigned u = 1; u < info.len; u++)
+        {
+            if (!Fetch(u, data))
+            {
+                return false;
+            }
+        }
+
+        for (unsigned u = info.len; u < info.cycles; u++)
+        {
+            if (!Dummy((uint16_t)(m_pc + info.len - 1)))
+            {
+                return false;
+            }
+        }
+
+        m_pc = (uint16_t)(m_pc + info.len);
+        return true;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Execute an interrupt sequence
+//
+// The 65C02 reads the opcode of the next instruction twice and ignores it,
+// and pushes the status with the B flag clear.
+bool Cpu65C02::Interrupt(
+    CpuBus &bus,
+    uint16_t vector)
+{
+    CpuValue data;
+    CpuValue lo;
+    CpuValue hi;
+    uint16_t addr = m_pc;
+
+    m_bus = &bus;
+    m_learn = NULL;
+    m_instrPC = m_pc;
+    m_waiting = false;
+    memset(m_bytes, 0, sizeof(m_bytes));
+
+    if (!Bus(CPU_READ, addr, 0xFFFF, data) || !Bus(CPU_READ, addr, 0xFFFF, data)
+        || !PushPC(m_pc) || !PushStatus(false))
+    {
+        return false;
+    }
+
+    SetFlag(CPU_FLAG_I, true);
+    SetFlag(CPU_FLAG_D, false);
+
+    addr = vector;
+    if (!Bus(CPU_READ, addr, 0xFFFF, lo))
+    {
+        return false;
+    }
+
+    addr++;
+    if (!Bus(CPU_READ, addr, 0xFFFF, hi))
+    {
+        return false;
+    }
+
+    m_pc = (uint16_t)(lo.value | (hi.value << 8));
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Format the registers as text
+//
+// Unknown registers and flags are shown as question marks. Flags that are
+// set are shown in upper case.
+size_t Cpu65C02::Format(
+    char *pText) const
+{
+    static const char flags[] = "NV--DIZC";
+    const CpuValue *regs[] = { &m_a, &m_x, &m_y, &m_s };
+    char *p = pText;
+
+    for (unsigned u = 0; u < 4; u++)
+    {
+        if (regs[u]->known)
+        {
+            p += sprintf(p, "%c=%02X ", "AXYS"[u], regs[u]->value);
+        }
+        else
+        {
+            p += sprintf(p, "%c=?? ", "AXYS"[u]);
+        }
+    }
+
+    *p++ = 'P';
+    *p++ = '=';
+
+    for (unsigned u = 0; u < 8; u++)
+    {
+        uint8_t flag = (uint8_t)(0x80 >> u);
+
+        if (!(flag & CPU_FLAGS))
+        {
+            *p++ = '-';
+        }
+        else if (!(m_pKnown & flag))
+        {
+            *p++ = '?';
+        }
+        else
+        {
+            *p++ = (char)((m_p & flag) ? flags[u] : (flags[u] | 0x20));
+        }
+    }
+
+    *p = '\0';
+
+    return (size_t)(p - pText);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
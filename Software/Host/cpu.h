@@ -0,0 +1,231 @@
+/*
+ * cpu.h
+ *
+ * Cycle-accurate model of the bus cycles of the 65C02
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef CPU_H
+#define CPU_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "disasm.h"
+#include <cstddef>
+#include <cstdint>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Flags in the processor status register
+#define CPU_FLAG_C          (0x01)      // Carry
+#define CPU_FLAG_Z          (0x02)      // Zero
+#define CPU_FLAG_I          (0x04)      // Interrupt disable
+#define CPU_FLAG_D          (0x08)      // Decimal mode
+#define CPU_FLAG_B          (0x10)      // Break (only on the stack)
+#define CPU_FLAG_1          (0x20)      // Always 1 (only on the stack)
+#define CPU_FLAG_V          (0x40)      // Overflow
+#define CPU_FLAG_N          (0x80)      // Negative
+#define CPU_FLAGS           (0xCF)      // Flags that are stored
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Kinds of bus cycles
+enum CpuAccess
+{
+    CPU_READ,                           // Read
+    CPU_WRITE,                          // Write
+    CPU_DUMMY,                          // Read whose address doesn't matter
+};
+
+
+//---------------------------------------------------------------------------
+// Register value or data that may be unknown
+struct CpuValue
+{
+    uint8_t value;
+    bool    known;
+};
+
+
+//---------------------------------------------------------------------------
+// Bus for the model
+//
+// The model doesn't have memory: the bus provides the data of each read,
+// and gets the data of each write to compare it.
+class CpuBus
+{
+public:
+    virtual ~CpuBus() {}
+
+    // The bits of the address that are 0 in the mask are unknown, because
+    // they depend on a register that's unknown; the bus returns the actual
+    // address so the model can learn the register from it. Dummy cycles
+    // have a mask of 0.
+    virtual bool                        // Returns false to stop
+    Access(
+        CpuAccess access,               // Kind of cycle
+        uint16_t &addr,                 // Address; returns actual address
+        uint16_t mask,                  // Known bits of the address
+        CpuValue &data) = 0;            // Write data; returns actual data
+
+    virtual bool                        // Returns false if not known
+    Remaining(
+        unsigned &cycles) = 0;          // Returns cycles left in instruction
+
+    virtual bool                        // Returns false if not known
+    Peek(
+        unsigned offset,                // Cycles ahead of the next one
+        uint16_t &addr) = 0;            // Returns address of the cycle
+};
+
+
+//---------------------------------------------------------------------------
+// 65C02 model
+//
+// The model executes one instruction at a time and generates the same
+// sequence of bus cycles as the WDC W65C02S, including the dummy cycles.
+//
+// When the model starts anywhere else than at a reset, the registers are
+// unknown. They are learned from the bus as the program runs: a load
+// gives a register a value, an indexed access gives away the index
+// register, a stack access gives away the stack pointer, and a store
+// gives away the register that's stored. Where the number of cycles of an
+// instruction depends on an unknown flag or register (a branch, a page
+// crossing, decimal mode), the bus tells how many cycles are left.
+class Cpu65C02
+{
+public:
+    Cpu65C02();
+
+    void Reset(                         // Registers after a reset
+        uint16_t pc,                    // First instruction
+        CpuValue s);                    // Stack pointer
+
+    void Unknown(                       // All registers unknown
+        uint16_t pc);                   // Next instruction
+
+    bool                                // Returns false if the bus stopped
+    Step(
+        CpuBus &bus);                   // Execute an instruction
+
+    bool                                // Returns false if the bus stopped
+    Interrupt(
+        CpuBus &bus,                    // Execute an interrupt sequence
+        uint16_t vector);               // Address of vector
+
+    uint16_t PC() const                 // Next (or current) instruction
+    {
+        return m_instrPC;
+    }
+
+    const uint8_t *Bytes() const        // Opcode and operands fetched so far
+    {
+        return m_bytes;
+    }
+
+    bool Waiting() const                // Last instruction was WAI or STP
+    {
+        return m_waiting;
+    }
+
+    bool Stopped() const                // Last instruction was STP
+    {
+        return m_stopped;
+    }
+
+    size_t                              // Returns length of text
+    Format(
+        char *pText) const;             // Registers, at least 32 characters
+
+private:
+    bool Bus(CpuAccess access, uint16_t &addr, uint16_t mask, CpuValue &data);
+    bool Fetch(unsigned offset, CpuValue &data);
+    bool Dummy(uint16_t addr);
+    bool Push(CpuValue &data);
+    bool Pull(CpuValue &data);
+    bool PushPC(uint16_t pc);
+    bool PushStatus(bool brk);
+    bool Address(const OpcodeInfo &info, unsigned after, uint16_t &ea,
+        uint16_t &mask);
+    bool Indexed(uint16_t base, CpuValue &index, const OpcodeInfo &info,
+        unsigned after, uint16_t &ea, uint16_t &mask);
+    bool Decimal(const OpcodeInfo &info, bool &decimal, bool &known);
+    void SetFlag(uint8_t flag, bool set);
+    void Forget(uint8_t flags);
+    bool Flag(uint8_t flag, bool &set) const;
+    void SetNZ(CpuValue v);
+    void Load(CpuValue &reg, CpuValue v);
+    void Add(uint8_t m, bool decimal);
+    void Subtract(uint8_t m, bool decimal);
+    void Compare(CpuValue reg, uint8_t m);
+    CpuValue Modify(unsigned operation, uint8_t opcode, CpuValue m);
+    bool Read(unsigned operation, const OpcodeInfo &info);
+    bool Write(unsigned operation, const OpcodeInfo &info);
+    bool ReadModifyWrite(unsigned operation, const OpcodeInfo &info);
+    bool Condition(uint8_t flag, bool set);
+    bool Branch(bool taken, unsigned len);
+
+    CpuBus  *m_bus;                     // Bus during Step and Interrupt
+    CpuValue m_a;
+    CpuValue m_x;
+    CpuValue m_y;
+    CpuValue m_s;
+    uint8_t  m_p;                       // Processor status
+    uint8_t  m_pKnown;                  // Flags that are known
+    uint16_t m_pc;                      // Program counter
+    uint16_t m_instrPC;                 // Address of current instruction
+    uint8_t  m_bytes[3];                // Opcode and operand bytes
+    bool     m_waiting;                 // WAI or STP executed
+    bool     m_stopped;                 // STP executed
+    CpuValue *m_learn;                  // Register to learn from address
+    uint16_t m_learnBase;               // Address if the register is 0
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,726 @@
+/*
+ * decoder.cpp
+ *
+ * Reconstructing 65C02 instructions from the cycles in a trace
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "decoder.h"
+#include "disasm.h"
+#include <cstring>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Number of cycles that the window loads or releases at a time
+#define WINDOW_CHUNK        (65536)
+
+// Number of cycles after the expected end of an instruction where the
+// decoder still looks for the next opcode fetch. WAI waits for an
+// interrupt, so it gets a lot more.
+#define DECODE_SLACK        (8)
+#define DECODE_SLACK_WAIT   (1 << 20)
+
+// Number of instructions that have to decode without problems to regain
+// synchronization, and the number of cycles to search at a time
+#define SYNC_INSTRUCTIONS   (6)
+#define SYNC_SEARCH         (65536)
+
+// Interrupt vectors
+#define VECTOR_NMI          (0xFFFA)
+#define VECTOR_RESET        (0xFFFC)
+#define VECTOR_IRQ          (0xFFFE)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+TraceWindow::TraceWindow(
+    TraceSource &source,
+    unsigned dataDelay)
+    : m_source(source)
+    , m_delay(dataDelay)
+    , m_first(0)
+    , m_released(0)
+    , m_end(false)
+{
+    m_cycles.reserve(2 * WINDOW_CHUNK);
+}
+
+
+//---------------------------------------------------------------------------
+// Load cycles from the source until the given cycle is in the window
+//
+// To apply the data delay, the trace longs are kept in a short queue until
+// the long with their data has been read.
+bool TraceWindow::Load(
+    uint64_t cycle)
+{
+    // Load a chunk at a time to keep the overhead low
+    uint64_t last = cycle + WINDOW_CHUNK;
+
+    while (!m_end && (m_first + m_cycles.size() <= last))
+    {
+        uint32_t raw;
+
+        if (!m_source.Next(raw))
+        {
+            m_end = true;
+            break;
+        }
+
+        if (!m_delay)
+        {
+            m_cycles.push_back(raw);
+            continue;
+        }
+
+        m_pending.push_back(raw);
+        if (m_pending.size() > m_delay)
+        {
+            m_cycles.push_back((m_pending[0] & ~TRACE_MASK_DATA)
+                | (raw & TRACE_MASK_DATA));
+            m_pending.erase(m_pending.begin());
+        }
+    }
+
+    return cycle < m_first + m_cycles.size();
+}
+
+
+//---------------------------------------------------------------------------
+// Release cycles that aren't needed anymore
+void TraceWindow::Release(
+    uint64_t cycle)
+{
+    if (cycle > m_released)
+    {
+        m_released = cycle;
+    }
+
+    // Only discard whole chunks, so the cycles aren't moved too often
+    if (m_released - m_first >= WINDOW_CHUNK)
+    {
+        size_t n = (size_t)(m_released - m_first);
+
+        if (n > m_cycles.size())
+        {
+            n = m_cycles.size();
+        }
+
+        m_cycles.erase(m_cycles.begin(), m_cycles.begin() + n);
+        m_first += n;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Constructor
+Decoder::Decoder(
+    TraceWindow &window)
+    : m_window(window)
+    , m_cycle(0)
+    , m_pc(0)
+    , m_synced(false)
+    , m_end(false)
+{
+}
+
+
+//---------------------------------------------------------------------------
+// Get the data of a cycle, or 0 beyond the end of the trace
+unsigned Decoder::Data(
+    uint64_t cycle)
+{
+    TraceRecord r;
+
+    return m_window.Get(cycle, r) ? r.Data() : 0;
+}
+
+
+//---------------------------------------------------------------------------
+// Check for an interrupt sequence
+//
+// The 65C02 reads the opcode at the PC twice (and ignores it), pushes
+// three bytes on the stack and reads the vector. During a reset, the
+// stack accesses are reads instead of writes. BRK is different because it
+// reads the byte after the opcode.
+bool Decoder::Interrupt(
+    uint64_t cycle,
+    uint16_t pc,
+    Instruction &instr)
+{
+    TraceRecord r[7];
+
+    // Most of the time, the second cycle already shows it's not an interrupt
+    for (unsigned u = 0; u < 2; u++)
+    {
+        if (!m_window.Get(cycle + u, r[u]) || !r[u].IsRead()
+            || (r[u].Addr() != pc))
+        {
+            return false;
+        }
+    }
+
+    for (unsigned u = 2; u < 7; u++)
+    {
+        if (!m_window.Get(cycle + u, r[u]))
+        {
+            return false;
+        }
+    }
+
+    bool reset = r[2].IsRead();
+
+    for (unsigned u = 2; u < 5; u++)
+    {
+        if (((r[u].Addr() & 0xFF00) != 0x0100) || (r[u].IsRead() != reset))
+        {
+            return false;
+        }
+    }
+
+    unsigned vector = r[5].Addr();
+
+    if (reset ? (vector != VECTOR_RESET)
+        : ((vector != VECTOR_IRQ) && (vector != VECTOR_NMI)))
+    {
+        return false;
+    }
+
+    if (!r[5].IsRead() || !r[6].IsRead() || (r[6].Addr() != vector + 1))
+    {
+        return false;
+    }
+
+    memset(&instr, 0, sizeof(instr));
+    instr.cycle = cycle;
+    instr.numCycles = 7;
+    instr.pc = pc;
+    instr.nextPC = (uint16_t)(r[5].Data() | (r[6].Data() << 8));
+    instr.bytes[0] = (uint8_t)r[0].Data();
+    instr.numBytes = 1;
+    instr.kind = reset ? INSTR_RESET
+        : (vector == VECTOR_NMI) ? INSTR_NMI : INSTR_IRQ;
+    instr.complete = true;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Check if an instruction starts at the given cycle
+//
+// Every instruction reads the byte after the opcode in its second cycle.
+// The end of the trace counts as a match.
+bool Decoder::IsFetch(
+    uint64_t cycle,
+    uint16_t pc)
+{
+    TraceRecord r;
+    Instruction instr;
+
+    if (!m_window.Get(cycle, r) || !r.IsRead() || (r.Addr() != pc))
+    {
+        return false;
+    }
+
+    if (!m_window.Get(cycle + 1, r))
+    {
+        return true;
+    }
+
+    if (r.IsRead() && (r.Addr() == (uint16_t)(pc + 1)))
+    {
+        return true;
+    }
+
+    return Interrupt(cycle, pc, instr);
+}
+
+
+//---------------------------------------------------------------------------
+// Decode the instruction at the given cycle and find the next one
+//
+// In strict mode, the next instruction has to start within the number of
+// cycles in the opcode table.
+Decoder::Step Decoder::Decode(
+    uint64_t cycle,
+    uint16_t pc,
+    bool strict,
+    Instruction &instr)
+{
+    TraceRecord r;
+
+    memset(&instr, 0, sizeof(instr));
+    instr.cycle = cycle;
+    instr.pc = pc;
+
+    if (!m_window.Get(cycle, r))
+    {
+        return STEP_END;
+    }
+
+    if (!r.IsRead() || (r.Addr() != pc))
+    {
+        return STEP_LOST;
+    }
+
+    if (Interrupt(cycle, pc, instr))
+    {
+        return STEP_OK;
+    }
+
+    const OpcodeInfo &op = g_opcodes[r.Data()];
+    unsigned len = op.len;
+    unsigned target = 0;
+    unsigned candidates[2];
+    unsigned numCandidates = 1;
+
+    instr.kind = INSTR_NORMAL;
+    instr.bytes[0] = (uint8_t)r.Data();
+    instr.numBytes = 1;
+
+    if ((len > 1) && m_window.Get(cycle + 1, r))
+    {
+        instr.bytes[1] = (uint8_t)r.Data();
+        instr.numBytes = 2;
+    }
+
+    // The second operand byte isn't always read in the third cycle
+    if ((len == 3) && (instr.numBytes == 2))
+    {
+        for (unsigned u = 2; u < op.cycles; u++)
+        {
+            if (m_window.Get(cycle + u, r) && r.IsRead()
+                && (r.Addr() == (uint16_t)(pc + 2)))
+            {
+                instr.bytes[2] = (uint8_t)r.Data();
+                instr.numBytes = 3;
+                break;
+            }
+        }
+    }
+
+    if (op.mode == MODE_ZPR)
+    {
+        target = (uint16_t)(pc + 3 + (int8_t)instr.bytes[2]);
+    }
+    else if (op.mode == MODE_REL)
+    {
+        target = (uint16_t)(pc + 2 + (int8_t)instr.bytes[1]);
+    }
+
+    // Work out where the next instruction can be
+    candidates[0] = (uint16_t)(pc + len);
+
+    switch (op.flow)
+    {
+    case FLOW_BRANCH:
+        candidates[1] = target;
+        numCandidates = 2;
+        break;
+
+    case FLOW_BRA:
+        candidates[0] = target;
+        break;
+
+    case FLOW_JMP:
+    case FLOW_JSR:
+        candidates[0] = instr.bytes[1] | (instr.bytes[2] << 8);
+        break;
+
+    case FLOW_JMPIND:
+        // The last two cycles read the new PC
+        candidates[0] = Data(cycle + op.cycles - 2)
+            | (Data(cycle + op.cycles - 1) << 8);
+        break;
+
+    case FLOW_RTS:
+        candidates[0] = (uint16_t)((Data(cycle + 3)
+            | (Data(cycle + 4) << 8)) + 1);
+        break;
+
+    case FLOW_RTI:
+        candidates[0] = Data(cycle + 4) | (Data(cycle + 5) << 8);
+        break;
+
+    case FLOW_BRK:
+        candidates[0] = Data(cycle + 5) | (Data(cycle + 6) << 8);
+        break;
+
+    case FLOW_WAIT:
+        // After STP, only a reset helps
+        if (instr.bytes[0] == 0xDB)
+        {
+            numCandidates = 0;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // Find the next opcode fetch
+    uint64_t first = cycle + op.cycles;
+    uint64_t last = first + op.extra
+        + ((op.flow == FLOW_WAIT) ? DECODE_SLACK_WAIT
+        : strict ? 0 : DECODE_SLACK);
+
+    // If the trace ends before the instruction does, only report the
+    // cycles that are actually in the trace
+    for (uint64_t j = cycle + 1; j < first; j++)
+    {
+        if (!m_window.Get(j, r))
+        {
+            instr.numCycles = (unsigned)(j - cycle);
+            return STEP_END;
+        }
+    }
+
+    instr.numCycles = op.cycles;
+    instr.complete = true;
+
+    for (uint64_t j = first; j <= last; j++)
+    {
+        if (!m_window.Get(j, r))
+        {
+            instr.numCycles = (unsigned)(j - cycle);
+            instr.complete = (j == first);
+            return STEP_END;
+        }
+
+        for (unsigned u = 0; u < numCandidates; u++)
+        {
+            if (IsFetch(j, (uint16_t)candidates[u]))
+            {
+                instr.numCycles = (unsigned)(j - cycle);
+                instr.extra = instr.numCycles - op.cycles;
+                instr.nextPC = (uint16_t)candidates[u];
+
+                if (op.flow == FLOW_BRA)
+                {
+                    instr.taken = true;
+                }
+                else if (op.flow == FLOW_BRANCH)
+                {
+                    // A branch to the next instruction takes longer
+                    // when it's taken
+                    instr.taken = (target == candidates[0])
+                        ? (instr.extra != 0) : (u != 0);
+                }
+
+                return STEP_OK;
+            }
+        }
+    }
+
+    return STEP_LOST;
+}
+
+
+//---------------------------------------------------------------------------
+// Check if a series of instructions decodes from the given cycle
+bool Decoder::IsConsistent(
+    uint64_t cycle,
+    uint16_t pc)
+{
+    Instruction instr;
+
+    for (unsigned u = 0; u < SYNC_INSTRUCTIONS; u++)
+    {
+        switch (Decode(cycle, pc, true, instr))
+        {
+        case STEP_OK:
+            break;
+
+        case STEP_END:
+            // Can't tell; give it the benefit of the doubt
+            return true;
+
+        default:
+            return false;
+        }
+
+        cycle += instr.numCycles;
+        pc = instr.nextPC;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Find a cycle where the decoder can synchronize
+//
+// A read of the reset vector gives the address of the first instruction
+// after it. Otherwise, a cycle is good if it looks like an opcode fetch and
+// a few instructions decode from there.
+//
+// On return, the cycle is the one where decoding can start; if no such
+// cycle was found, it's the first cycle that hasn't been searched yet.
+bool Decoder::FindSync(
+    uint64_t &cycle,
+    uint16_t &pc,
+    bool &reset)
+{
+    uint64_t last = cycle + SYNC_SEARCH;
+    TraceRecord r;
+    TraceRecord r1;
+
+    for (uint64_t j = cycle; j < last; j++)
+    {
+        if (!m_window.Get(j, r))
+        {
+            cycle = j;
+            return false;
+        }
+
+        if (!r.IsRead() || !m_window.Get(j + 1, r1) || !r1.IsRead())
+        {
+            continue;
+        }
+
+        if ((r.Addr() == VECTOR_RESET) && (r1.Addr() == VECTOR_RESET + 1))
+        {
+            cycle = j + 2;
+            pc = (uint16_t)(r.Data() | (r1.Data() << 8));
+            reset = true;
+            return true;
+        }
+
+        if ((r1.Addr() == (uint16_t)(r.Addr() + 1))
+            && IsConsistent(j, (uint16_t)r.Addr()))
+        {
+            cycle = j;
+            pc = (uint16_t)r.Addr();
+            reset = false;
+            return true;
+        }
+    }
+
+    cycle = last;
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the next instruction
+bool Decoder::Next(
+    Instruction &instr)
+{
+    // The caller is done with the previous instruction
+    m_window.Release(m_cycle);
+
+    while (!m_end)
+    {
+        if (!m_synced)
+        {
+            uint64_t cycle = m_cycle;
+            uint16_t pc;
+            bool reset;
+            bool found = FindSync(cycle, pc, reset);
+            uint64_t start = cycle;
+
+            if (found && reset)
+            {
+                // Include the reset sequence before the vector in the
+                // instruction that jumps to the reset handler
+                start = (cycle > m_cycle + 7) ? cycle - 7 : m_cycle;
+            }
+
+            if (start > m_cycle)
+            {
+                // Report the cycles before synchronization as unknown
+                memset(&instr, 0, sizeof(instr));
+                instr.cycle = m_cycle;
+                instr.numCycles = (unsigned)(start - m_cycle);
+                instr.kind = INSTR_UNKNOWN;
+                instr.complete = true;
+
+                m_cycle = start;
+                return true;
+            }
+
+            if (!found)
+            {
+                m_end = true;
+                break;
+            }
+
+            m_synced = true;
+            m_pc = pc;
+
+            if (reset)
+            {
+                TraceRecord r;
+
+                memset(&instr, 0, sizeof(instr));
+                instr.cycle = m_cycle;
+                instr.pc = m_window.Get(m_cycle, r) ? (uint16_t)r.Addr() : 0;
+                instr.numCycles = (unsigned)(cycle - m_cycle);
+                instr.nextPC = pc;
+                instr.kind = INSTR_RESET;
+                instr.complete = true;
+
+                m_cycle = cycle;
+                return true;
+            }
+        }
+
+        switch (Decode(m_cycle, m_pc, false, instr))
+        {
+        case STEP_OK:
+            break;
+
+        case STEP_END:
+            m_end = true;
+            if (!instr.numCycles)
+            {
+                return false;
+            }
+            break;
+
+        default:
+            m_synced = false;
+            if (!instr.numCycles)
+            {
+                // Wrong address at the start of the instruction
+                continue;
+            }
+            break;
+        }
+
+        m_cycle += instr.numCycles;
+        m_pc = instr.nextPC;
+        return true;
+    }
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the role of a cycle of an instruction
+CycleRole Decoder::Role(
+    const Instruction &instr,
+    uint64_t cycle,
+    const TraceRecord &r)
+{
+    unsigned offset = (unsigned)(cycle - instr.cycle);
+    unsigned addr = r.Addr();
+
+    switch (instr.kind)
+    {
+    case INSTR_NORMAL:
+        break;
+
+    case INSTR_IRQ:
+    case INSTR_NMI:
+    case INSTR_RESET:
+        if (addr >= VECTOR_NMI)
+        {
+            return ROLE_VECTOR;
+        }
+
+        if ((offset >= 2) && ((addr & 0xFF00) == 0x0100))
+        {
+            return ROLE_STACK;
+        }
+
+        return r.IsRead() ? ROLE_READ : ROLE_WRITE;
+
+    default:
+        return ROLE_UNKNOWN;
+    }
+
+    if (!offset)
+    {
+        return ROLE_FETCH;
+    }
+
+    const OpcodeInfo &op = g_opcodes[instr.bytes[0]];
+
+    if (r.IsRead() && (offset < op.cycles)
+        && (addr >= (uint16_t)(instr.pc + 1))
+        && (addr < (uint16_t)(instr.pc + op.len)))
+    {
+        return ROLE_OPERAND;
+    }
+
+    if ((op.flow == FLOW_BRK) && (addr >= VECTOR_NMI))
+    {
+        return ROLE_VECTOR;
+    }
+
+    if ((addr & 0xFF00) == 0x0100)
+    {
+        switch (instr.bytes[0])
+        {
+        case 0x00:                      // BRK
+        case 0x08:                      // PHP
+        case 0x20:                      // JSR
+        case 0x28:                      // PLP
+        case 0x40:                      // RTI
+        case 0x48:                      // PHA
+        case 0x5A:                      // PHY
+        case 0x60:                      // RTS
+        case 0x68:                      // PLA
+        case 0x7A:                      // PLY
+        case 0xDA:                      // PHX
+        case 0xFA:                      // PLX
+            return ROLE_STACK;
+
+        default:
+            break;
+        }
+    }
+
+    return r.IsRead() ? ROLE_READ : ROLE_WRITE;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
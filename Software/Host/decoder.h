@@ -0,0 +1,201 @@
+/*
+ * decoder.h
+ *
+ * Reconstructing 65C02 instructions from the cycles in a trace
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef DECODER_H
+#define DECODER_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "trace.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Kinds of decoded instructions
+enum InstrKind
+{
+    INSTR_NORMAL,                       // Instruction, including BRK
+    INSTR_IRQ,                          // Interrupt sequence
+    INSTR_NMI,                          // Non-maskable interrupt sequence
+    INSTR_RESET,                        // Reset sequence
+    INSTR_UNKNOWN,                      // Cycles that couldn't be decoded
+};
+
+
+//---------------------------------------------------------------------------
+// Roles of the cycles of an instruction on the bus
+enum CycleRole
+{
+    ROLE_UNKNOWN,
+    ROLE_FETCH,                         // Opcode fetch
+    ROLE_OPERAND,                       // Operand fetch
+    ROLE_READ,                          // Other read
+    ROLE_WRITE,                         // Other write
+    ROLE_STACK,                         // Stack push or pull
+    ROLE_VECTOR,                        // Interrupt vector fetch
+};
+
+
+//---------------------------------------------------------------------------
+// Decoded instruction
+struct Instruction
+{
+    uint64_t cycle;                     // Index of first cycle
+    unsigned numCycles;                 // Number of cycles
+    unsigned extra;                     // Cycles more than the minimum
+    uint16_t pc;                        // Address of the opcode
+    uint16_t nextPC;                    // Address of next instruction
+    uint8_t  bytes[3];                  // Opcode and operand bytes
+    uint8_t  numBytes;                  // Number of bytes found in trace
+    uint8_t  kind;                      // InstrKind
+    bool     taken;                     // Branch was taken
+    bool     complete;                  // False if the trace ends early
+};
+
+
+//---------------------------------------------------------------------------
+// Sliding window on the cycles of a trace
+//
+// The decoder looks ahead a few cycles to find where the next instruction
+// starts, so the cycles are kept in memory until they're released.
+//
+// The data of each cycle can be taken from a later trace long, in case the
+// data bus was stored with a delay.
+class TraceWindow
+{
+public:
+    TraceWindow(
+        TraceSource &source,            // Source of trace longs
+        unsigned dataDelay);            // Num of longs to delay data by
+
+    bool                                // Returns false beyond end of trace
+    Get(
+        uint64_t cycle,                 // Index of cycle
+        TraceRecord &r)                 // Returns cycle
+    {
+        if ((cycle < m_first + m_cycles.size()) || Load(cycle))
+        {
+            r.raw = m_cycles[(size_t)(cycle - m_first)];
+            return true;
+        }
+
+        return false;
+    }
+
+    void Release(
+        uint64_t cycle);                // Cycles before this aren't needed
+
+private:
+    bool Load(uint64_t cycle);
+
+    TraceSource          &m_source;
+    unsigned              m_delay;
+    std::vector<uint32_t> m_cycles;     // Cycles starting at m_first
+    uint64_t              m_first;
+    uint64_t              m_released;   // Cycles before this not needed
+    std::vector<uint32_t> m_pending;    // Longs waiting for their data
+    bool                  m_end;
+};
+
+
+//---------------------------------------------------------------------------
+// Instruction decoder
+//
+// There is no SYNC signal in the trace, so the decoder finds the opcode
+// fetches by following the program: for each instruction, it computes where
+// the next one starts from the opcode and the data on the bus, and finds
+// the cycle where that address is read and followed by a read of the next
+// address (or by an interrupt sequence). This makes the decoder independent
+// of the exact number of cycles of each instruction.
+//
+// At the start of the trace, and whenever the program can't be followed,
+// the decoder looks for a reset sequence or a series of cycles that decodes
+// consistently, and reports the cycles before that as unknown.
+class Decoder
+{
+public:
+    Decoder(
+        TraceWindow &window);           // Cycles to decode
+
+    bool                                // Returns false at end of trace
+    Next(
+        Instruction &instr);            // Returns next instruction
+
+    // Role of a cycle of an instruction
+    static CycleRole Role(
+        const Instruction &instr,       // Instruction
+        uint64_t cycle,                 // Index of cycle in instruction
+        const TraceRecord &r);          // Cycle
+
+private:
+    enum Step
+    {
+        STEP_OK,
+        STEP_END,                       // Trace ends during instruction
+        STEP_LOST,                      // Next instruction not found
+    };
+
+    Step Decode(uint64_t cycle, uint16_t pc, bool strict, Instruction &instr);
+    bool Interrupt(uint64_t cycle, uint16_t pc, Instruction &instr);
+    bool IsFetch(uint64_t cycle, uint16_t pc);
+    bool IsConsistent(uint64_t cycle, uint16_t pc);
+    bool FindSync(uint64_t &cycle, uint16_t &pc, bool &reset);
+    unsigned Data(uint64_t cycle);
+
+    TraceWindow &m_window;
+    uint64_t     m_cycle;               // Next cycle to decode
+    uint16_t     m_pc;                  // Address of next instruction
+    bool         m_synced;              // Next instruction is at m_pc
+    bool         m_end;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ * disasm.cpp
+ *
+ * 65C02 opcode table and disassembler, including the WDC extensions
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "disasm.h"
+#include <cstdio>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DATA
+/////////////////////////////////////////////////////////////////////////////
+
+
+// The cycle counts are from the WDC W65C02S datasheet. The extra cycles
+// are for crossing a page boundary with an indexed read, for ADC and SBC
+// in decimal mode, and for taken branches (one more if the target is in
+// another page). The opcodes that are undefined on the NMOS 6502 are NOPs
+// of various lengths on the 65C02; the ones ending in 3 or B (except WAI
+// and STP) take only one cycle.
+const OpcodeInfo g_opcodes[256] =
+{
+    { "BRK",  MODE_IMP, 1, 7, 0, FLOW_BRK     },  // 00
+    { "ORA",  MODE_IZX, 2, 6, 0, FLOW_NONE    },  // 01
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 02
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 03
+    { "TSB",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 04
+    { "ORA",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 05
+    { "ASL",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 06
+    { "RMB0", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 07
+    { "PHP",  MODE_IMP, 1, 3, 0, FLOW_NONE    },  // 08
+    { "ORA",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 09
+    { "ASL",  MODE_ACC, 1, 2, 0, FLOW_NONE    },  // 0A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 0B
+    { "TSB",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // 0C
+    { "ORA",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 0D
+    { "ASL",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // 0E
+    { "BBR0", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 0F
+    { "BPL",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // 10
+    { "ORA",  MODE_IZY, 2, 5, 1, FLOW_NONE    },  // 11
+    { "ORA",  MODE_IZP, 2, 5, 0, FLOW_NONE    },  // 12
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 13
+    { "TRB",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 14
+    { "ORA",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 15
+    { "ASL",  MODE_ZPX, 2, 6, 0, FLOW_NONE    },  // 16
+    { "RMB1", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 17
+    { "CLC",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 18
+    { "ORA",  MODE_ABY, 3, 4, 1, FLOW_NONE    },  // 19
+    { "INC",  MODE_ACC, 1, 2, 0, FLOW_NONE    },  // 1A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 1B
+    { "TRB",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // 1C
+    { "ORA",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // 1D
+    { "ASL",  MODE_ABX, 3, 6, 1, FLOW_NONE    },  // 1E
+    { "BBR1", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 1F
+    { "JSR",  MODE_ABS, 3, 6, 0, FLOW_JSR     },  // 20
+    { "AND",  MODE_IZX, 2, 6, 0, FLOW_NONE    },  // 21
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 22
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 23
+    { "BIT",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 24
+    { "AND",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 25
+    { "ROL",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 26
+    { "RMB2", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 27
+    { "PLP",  MODE_IMP, 1, 4, 0, FLOW_NONE    },  // 28
+    { "AND",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 29
+    { "ROL",  MODE_ACC, 1, 2, 0, FLOW_NONE    },  // 2A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 2B
+    { "BIT",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 2C
+    { "AND",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 2D
+    { "ROL",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // 2E
+    { "BBR2", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 2F
+    { "BMI",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // 30
+    { "AND",  MODE_IZY, 2, 5, 1, FLOW_NONE    },  // 31
+    { "AND",  MODE_IZP, 2, 5, 0, FLOW_NONE    },  // 32
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 33
+    { "BIT",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 34
+    { "AND",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 35
+    { "ROL",  MODE_ZPX, 2, 6, 0, FLOW_NONE    },  // 36
+    { "RMB3", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 37
+    { "SEC",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 38
+    { "AND",  MODE_ABY, 3, 4, 1, FLOW_NONE    },  // 39
+    { "DEC",  MODE_ACC, 1, 2, 0, FLOW_NONE    },  // 3A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 3B
+    { "BIT",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // 3C
+    { "AND",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // 3D
+    { "ROL",  MODE_ABX, 3, 6, 1, FLOW_NONE    },  // 3E
+    { "BBR3", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 3F
+    { "RTI",  MODE_IMP, 1, 6, 0, FLOW_RTI     },  // 40
+    { "EOR",  MODE_IZX, 2, 6, 0, FLOW_NONE    },  // 41
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 42
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 43
+    { "NOP",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 44
+    { "EOR",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 45
+    { "LSR",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 46
+    { "RMB4", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 47
+    { "PHA",  MODE_IMP, 1, 3, 0, FLOW_NONE    },  // 48
+    { "EOR",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 49
+    { "LSR",  MODE_ACC, 1, 2, 0, FLOW_NONE    },  // 4A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 4B
+    { "JMP",  MODE_ABS, 3, 3, 0, FLOW_JMP     },  // 4C
+    { "EOR",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 4D
+    { "LSR",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // 4E
+    { "BBR4", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 4F
+    { "BVC",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // 50
+    { "EOR",  MODE_IZY, 2, 5, 1, FLOW_NONE    },  // 51
+    { "EOR",  MODE_IZP, 2, 5, 0, FLOW_NONE    },  // 52
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 53
+    { "NOP",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 54
+    { "EOR",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 55
+    { "LSR",  MODE_ZPX, 2, 6, 0, FLOW_NONE    },  // 56
+    { "RMB5", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 57
+    { "CLI",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 58
+    { "EOR",  MODE_ABY, 3, 4, 1, FLOW_NONE    },  // 59
+    { "PHY",  MODE_IMP, 1, 3, 0, FLOW_NONE    },  // 5A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 5B
+    { "NOP",  MODE_ABS, 3, 8, 0, FLOW_NONE    },  // 5C
+    { "EOR",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // 5D
+    { "LSR",  MODE_ABX, 3, 6, 1, FLOW_NONE    },  // 5E
+    { "BBR5", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 5F
+    { "RTS",  MODE_IMP, 1, 6, 0, FLOW_RTS     },  // 60
+    { "ADC",  MODE_IZX, 2, 6, 1, FLOW_NONE    },  // 61
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 62
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 63
+    { "STZ",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 64
+    { "ADC",  MODE_ZP,  2, 3, 1, FLOW_NONE    },  // 65
+    { "ROR",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 66
+    { "RMB6", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 67
+    { "PLA",  MODE_IMP, 1, 4, 0, FLOW_NONE    },  // 68
+    { "ADC",  MODE_IMM, 2, 2, 1, FLOW_NONE    },  // 69
+    { "ROR",  MODE_ACC, 1, 2, 0, FLOW_NONE    },  // 6A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 6B
+    { "JMP",  MODE_IND, 3, 6, 0, FLOW_JMPIND  },  // 6C
+    { "ADC",  MODE_ABS, 3, 4, 1, FLOW_NONE    },  // 6D
+    { "ROR",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // 6E
+    { "BBR6", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 6F
+    { "BVS",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // 70
+    { "ADC",  MODE_IZY, 2, 5, 2, FLOW_NONE    },  // 71
+    { "ADC",  MODE_IZP, 2, 5, 1, FLOW_NONE    },  // 72
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 73
+    { "STZ",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 74
+    { "ADC",  MODE_ZPX, 2, 4, 1, FLOW_NONE    },  // 75
+    { "ROR",  MODE_ZPX, 2, 6, 0, FLOW_NONE    },  // 76
+    { "RMB7", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 77
+    { "SEI",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 78
+    { "ADC",  MODE_ABY, 3, 4, 2, FLOW_NONE    },  // 79
+    { "PLY",  MODE_IMP, 1, 4, 0, FLOW_NONE    },  // 7A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 7B
+    { "JMP",  MODE_AIX, 3, 6, 0, FLOW_JMPIND  },  // 7C
+    { "ADC",  MODE_ABX, 3, 4, 2, FLOW_NONE    },  // 7D
+    { "ROR",  MODE_ABX, 3, 6, 1, FLOW_NONE    },  // 7E
+    { "BBR7", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 7F
+    { "BRA",  MODE_REL, 2, 3, 1, FLOW_BRA     },  // 80
+    { "STA",  MODE_IZX, 2, 6, 0, FLOW_NONE    },  // 81
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 82
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 83
+    { "STY",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 84
+    { "STA",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 85
+    { "STX",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // 86
+    { "SMB0", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 87
+    { "DEY",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 88
+    { "BIT",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // 89
+    { "TXA",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 8A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 8B
+    { "STY",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 8C
+    { "STA",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 8D
+    { "STX",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 8E
+    { "BBS0", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 8F
+    { "BCC",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // 90
+    { "STA",  MODE_IZY, 2, 6, 0, FLOW_NONE    },  // 91
+    { "STA",  MODE_IZP, 2, 5, 0, FLOW_NONE    },  // 92
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 93
+    { "STY",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 94
+    { "STA",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // 95
+    { "STX",  MODE_ZPY, 2, 4, 0, FLOW_NONE    },  // 96
+    { "SMB1", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // 97
+    { "TYA",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 98
+    { "STA",  MODE_ABY, 3, 5, 0, FLOW_NONE    },  // 99
+    { "TXS",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // 9A
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // 9B
+    { "STZ",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // 9C
+    { "STA",  MODE_ABX, 3, 5, 0, FLOW_NONE    },  // 9D
+    { "STZ",  MODE_ABX, 3, 5, 0, FLOW_NONE    },  // 9E
+    { "BBS1", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // 9F
+    { "LDY",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // A0
+    { "LDA",  MODE_IZX, 2, 6, 0, FLOW_NONE    },  // A1
+    { "LDX",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // A2
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // A3
+    { "LDY",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // A4
+    { "LDA",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // A5
+    { "LDX",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // A6
+    { "SMB2", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // A7
+    { "TAY",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // A8
+    { "LDA",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // A9
+    { "TAX",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // AA
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // AB
+    { "LDY",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // AC
+    { "LDA",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // AD
+    { "LDX",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // AE
+    { "BBS2", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // AF
+    { "BCS",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // B0
+    { "LDA",  MODE_IZY, 2, 5, 1, FLOW_NONE    },  // B1
+    { "LDA",  MODE_IZP, 2, 5, 0, FLOW_NONE    },  // B2
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // B3
+    { "LDY",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // B4
+    { "LDA",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // B5
+    { "LDX",  MODE_ZPY, 2, 4, 0, FLOW_NONE    },  // B6
+    { "SMB3", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // B7
+    { "CLV",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // B8
+    { "LDA",  MODE_ABY, 3, 4, 1, FLOW_NONE    },  // B9
+    { "TSX",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // BA
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // BB
+    { "LDY",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // BC
+    { "LDA",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // BD
+    { "LDX",  MODE_ABY, 3, 4, 1, FLOW_NONE    },  // BE
+    { "BBS3", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // BF
+    { "CPY",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // C0
+    { "CMP",  MODE_IZX, 2, 6, 0, FLOW_NONE    },  // C1
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // C2
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // C3
+    { "CPY",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // C4
+    { "CMP",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // C5
+    { "DEC",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // C6
+    { "SMB4", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // C7
+    { "INY",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // C8
+    { "CMP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // C9
+    { "DEX",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // CA
+    { "WAI",  MODE_IMP, 1, 3, 0, FLOW_WAIT    },  // CB
+    { "CPY",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // CC
+    { "CMP",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // CD
+    { "DEC",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // CE
+    { "BBS4", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // CF
+    { "BNE",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // D0
+    { "CMP",  MODE_IZY, 2, 5, 1, FLOW_NONE    },  // D1
+    { "CMP",  MODE_IZP, 2, 5, 0, FLOW_NONE    },  // D2
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // D3
+    { "NOP",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // D4
+    { "CMP",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // D5
+    { "DEC",  MODE_ZPX, 2, 6, 0, FLOW_NONE    },  // D6
+    { "SMB5", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // D7
+    { "CLD",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // D8
+    { "CMP",  MODE_ABY, 3, 4, 1, FLOW_NONE    },  // D9
+    { "PHX",  MODE_IMP, 1, 3, 0, FLOW_NONE    },  // DA
+    { "STP",  MODE_IMP, 1, 3, 0, FLOW_WAIT    },  // DB
+    { "NOP",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // DC
+    { "CMP",  MODE_ABX, 3, 4, 1, FLOW_NONE    },  // DD
+    { "DEC",  MODE_ABX, 3, 7, 0, FLOW_NONE    },  // DE
+    { "BBS5", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // DF
+    { "CPX",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // E0
+    { "SBC",  MODE_IZX, 2, 6, 1, FLOW_NONE    },  // E1
+    { "NOP",  MODE_IMM, 2, 2, 0, FLOW_NONE    },  // E2
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // E3
+    { "CPX",  MODE_ZP,  2, 3, 0, FLOW_NONE    },  // E4
+    { "SBC",  MODE_ZP,  2, 3, 1, FLOW_NONE    },  // E5
+    { "INC",  MODE_ZP,  2, 5, 0, FLOW_NONE    },  // E6
+    { "SMB6", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // E7
+    { "INX",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // E8
+    { "SBC",  MODE_IMM, 2, 2, 1, FLOW_NONE    },  // E9
+    { "NOP",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // EA
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // EB
+    { "CPX",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // EC
+    { "SBC",  MODE_ABS, 3, 4, 1, FLOW_NONE    },  // ED
+    { "INC",  MODE_ABS, 3, 6, 0, FLOW_NONE    },  // EE
+    { "BBS6", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // EF
+    { "BEQ",  MODE_REL, 2, 2, 2, FLOW_BRANCH  },  // F0
+    { "SBC",  MODE_IZY, 2, 5, 2, FLOW_NONE    },  // F1
+    { "SBC",  MODE_IZP, 2, 5, 1, FLOW_NONE    },  // F2
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // F3
+    { "NOP",  MODE_ZPX, 2, 4, 0, FLOW_NONE    },  // F4
+    { "SBC",  MODE_ZPX, 2, 4, 1, FLOW_NONE    },  // F5
+    { "INC",  MODE_ZPX, 2, 6, 0, FLOW_NONE    },  // F6
+    { "SMB7", MODE_ZP,  2, 5, 0, FLOW_NONE    },  // F7
+    { "SED",  MODE_IMP, 1, 2, 0, FLOW_NONE    },  // F8
+    { "SBC",  MODE_ABY, 3, 4, 2, FLOW_NONE    },  // F9
+    { "PLX",  MODE_IMP, 1, 4, 0, FLOW_NONE    },  // FA
+    { "NOP",  MODE_IMP, 1, 1, 0, FLOW_NONE    },  // FB
+    { "NOP",  MODE_ABS, 3, 4, 0, FLOW_NONE    },  // FC
+    { "SBC",  MODE_ABX, 3, 4, 2, FLOW_NONE    },  // FD
+    { "INC",  MODE_ABX, 3, 7, 0, FLOW_NONE    },  // FE
+    { "BBS7", MODE_ZPR, 3, 5, 2, FLOW_BRANCH  },  // FF
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Disassemble an instruction
+size_t Disassemble(
+    char *pText,
+    uint16_t pc,
+    const uint8_t *pBytes)
+{
+    const OpcodeInfo &op = g_opcodes[pBytes[0]];
+    unsigned b1 = pBytes[1];
+    unsigned w = pBytes[1] | (pBytes[2] << 8);
+    int n;
+
+    switch (op.mode)
+    {
+    case MODE_IMP: n = sprintf(pText, "%s", op.mnemonic); break;
+    case MODE_ACC: n = sprintf(pText, "%s A", op.mnemonic); break;
+    case MODE_IMM: n = sprintf(pText, "%s #$%02X", op.mnemonic, b1); break;
+    case MODE_ZP:  n = sprintf(pText, "%s $%02X", op.mnemonic, b1); break;
+    case MODE_ZPX: n = sprintf(pText, "%s $%02X,X", op.mnemonic, b1); break;
+    case MODE_ZPY: n = sprintf(pText, "%s $%02X,Y", op.mnemonic, b1); break;
+    case MODE_ABS: n = sprintf(pText, "%s $%04X", op.mnemonic, w); break;
+    case MODE_ABX: n = sprintf(pText, "%s $%04X,X", op.mnemonic, w); break;
+    case MODE_ABY: n = sprintf(pText, "%s $%04X,Y", op.mnemonic, w); break;
+    case MODE_IND: n = sprintf(pText, "%s ($%04X)", op.mnemonic, w); break;
+    case MODE_IZX: n = sprintf(pText, "%s ($%02X,X)", op.mnemonic, b1); break;
+    case MODE_IZY: n = sprintf(pText, "%s ($%02X),Y", op.mnemonic, b1); break;
+    case MODE_IZP: n = sprintf(pText, "%s ($%02X)", op.mnemonic, b1); break;
+    case MODE_AIX: n = sprintf(pText, "%s ($%04X,X)", op.mnemonic, w); break;
+
+    case MODE_REL:
+        n = sprintf(pText, "%s $%04X", op.mnemonic,
+            (unsigned)(uint16_t)(pc + 2 + (int8_t)pBytes[1]));
+        break;
+
+    case MODE_ZPR:
+        n = sprintf(pText, "%s $%02X,$%04X", op.mnemonic, b1,
+            (unsigned)(uint16_t)(pc + 3 + (int8_t)pBytes[2]));
+        break;
+
+    default:
+        n = sprintf(pText, "???");
+        break;
+    }
+
+    return (size_t)n;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
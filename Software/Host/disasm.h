@@ -0,0 +1,137 @@
+/*
+ * disasm.h
+ *
+ * 65C02 opcode table and disassembler, including the WDC extensions
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef DISASM_H
+#define DISASM_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Addressing modes
+enum AddrMode
+{
+    MODE_IMP,                           // Implied
+    MODE_ACC,                           // Accumulator
+    MODE_IMM,                           // #$nn
+    MODE_ZP,                            // $nn
+    MODE_ZPX,                           // $nn,X
+    MODE_ZPY,                           // $nn,Y
+    MODE_ABS,                           // $nnnn
+    MODE_ABX,                           // $nnnn,X
+    MODE_ABY,                           // $nnnn,Y
+    MODE_IND,                           // ($nnnn)
+    MODE_IZX,                           // ($nn,X)
+    MODE_IZY,                           // ($nn),Y
+    MODE_IZP,                           // ($nn)
+    MODE_REL,                           // Branch
+    MODE_AIX,                           // ($nnnn,X)
+    MODE_ZPR,                           // $nn,branch (BBR/BBS)
+};
+
+
+//---------------------------------------------------------------------------
+// Kinds of instructions that change the program flow
+enum FlowKind
+{
+    FLOW_NONE,                          // Next instruction follows
+    FLOW_BRANCH,                        // Conditional branch, BBR, BBS
+    FLOW_BRA,                           // Branch always
+    FLOW_JMP,                           // JMP abs
+    FLOW_JMPIND,                        // JMP (abs), JMP (abs,X)
+    FLOW_JSR,
+    FLOW_RTS,
+    FLOW_RTI,
+    FLOW_BRK,
+    FLOW_WAIT,                          // WAI, STP
+};
+
+
+//---------------------------------------------------------------------------
+// Opcode information
+struct OpcodeInfo
+{
+    const char *mnemonic;
+    uint8_t     mode;                   // AddrMode
+    uint8_t     len;                    // Length in bytes
+    uint8_t     cycles;                 // Minimum number of cycles
+    uint8_t     extra;                  // Maximum number of extra cycles
+    uint8_t     flow;                   // FlowKind
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DATA
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Table indexed by opcode
+extern const OpcodeInfo g_opcodes[256];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Disassemble an instruction
+//
+// The operand bytes that aren't used by the instruction are ignored.
+size_t                                  // Returns length of text
+Disassemble(
+    char *pText,                        // Output, at least 32 characters
+    uint16_t pc,                        // Address of the opcode
+    const uint8_t *pBytes);             // Opcode and up to 2 operand bytes
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
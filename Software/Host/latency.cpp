@@ -0,0 +1,275 @@
+/*
+ * latency.cpp
+ *
+ * Measuring interrupt latency from a trace with signals
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "latency.h"
+#include <algorithm>
+#include <map>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Cycle of the first vector fetch in an interrupt sequence: after two reads
+// at the program counter and three stack writes
+#define LATENCY_VECTOR_CYCLE (5)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+LatencyMeter::LatencyMeter(
+    TraceWindow &window)
+    : m_window(window)
+    , m_started(false)
+{
+    m_irq.name = "IRQ";
+    m_irq.mask = TRACE_SIG_IRQ;
+    m_irq.level = true;
+    m_nmi.name = "NMI";
+    m_nmi.mask = TRACE_SIG_NMI;
+    m_nmi.level = false;
+
+    Line *lines[] = { &m_irq, &m_nmi };
+
+    for (unsigned u = 0; u < 2; u++)
+    {
+        lines[u]->active = false;
+        lines[u]->pending = false;
+        lines[u]->start = 0;
+        lines[u]->dropped = 0;
+        lines[u]->unrequested = 0;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Sort samples by latency, longest first
+bool LatencyMeter::ByLatency(
+    const Sample *a,
+    const Sample *b)
+{
+    return a->latency > b->latency;
+}
+
+
+//---------------------------------------------------------------------------
+// Follow the signal of an interrupt line
+void LatencyMeter::Update(
+    Line &line,
+    uint32_t raw,
+    uint64_t cycle)
+{
+    bool active = (raw & line.mask) != 0;
+
+    if (active && !line.active && !line.pending)
+    {
+        line.pending = true;
+        line.start = cycle;
+    }
+    else if (!active && line.pending && line.level)
+    {
+        line.pending = false;
+        line.dropped++;
+    }
+
+    line.active = active;
+}
+
+
+//---------------------------------------------------------------------------
+// Match an interrupt sequence to the pending request
+void LatencyMeter::Service(
+    Line &line,
+    const Instruction &instr)
+{
+    if (!line.pending)
+    {
+        // The request started before the trace, or the signal was only
+        // active between two trace cycles
+        line.unrequested++;
+        return;
+    }
+
+    Sample s;
+
+    s.cycle = line.start;
+    s.latency = instr.cycle + LATENCY_VECTOR_CYCLE - line.start;
+    s.pc = instr.pc;
+    line.samples.push_back(s);
+    line.pending = false;
+}
+
+
+//---------------------------------------------------------------------------
+// Add an instruction
+void LatencyMeter::Add(
+    const Instruction &instr)
+{
+    // The 6502 decides to start an interrupt sequence before the first
+    // cycle, so the request is matched before the signals of the sequence
+    // are looked at; an IRQ that's released during the sequence isn't
+    // dropped.
+    if (instr.kind == INSTR_IRQ)
+    {
+        Service(m_irq, instr);
+    }
+    else if (instr.kind == INSTR_NMI)
+    {
+        Service(m_nmi, instr);
+    }
+
+    for (uint64_t c = instr.cycle; c < instr.cycle + instr.numCycles; c++)
+    {
+        TraceRecord r;
+
+        if (!m_window.Get(c, r))
+        {
+            break;
+        }
+
+        if (!m_started)
+        {
+            // A signal that's active at the start of the trace was
+            // activated at an unknown time
+            m_irq.active = (r.raw & m_irq.mask) != 0;
+            m_nmi.active = (r.raw & m_nmi.mask) != 0;
+            m_started = true;
+        }
+
+        Update(m_irq, r.raw, c);
+        Update(m_nmi, r.raw, c);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Print the statistics of an interrupt line
+void LatencyMeter::ReportLine(
+    FILE *f,
+    Line &line,
+    unsigned top)
+{
+    std::map<uint64_t, uint64_t> histogram;
+    std::vector<const Sample *> worst;
+    uint64_t total = 0;
+    size_t n = line.samples.size();
+
+    for (size_t u = 0; u < n; u++)
+    {
+        histogram[line.samples[u].latency]++;
+        total += line.samples[u].latency;
+        worst.push_back(&line.samples[u]);
+    }
+
+    fprintf(f,
+        "%s: %llu requests serviced, %llu dropped, %llu pending at the end\n",
+        line.name,
+        (unsigned long long)n,
+        (unsigned long long)line.dropped,
+        (unsigned long long)(line.pending ? 1 : 0));
+
+    if (line.unrequested)
+    {
+        fprintf(f, "%llu %s sequences without a request in the trace\n",
+            (unsigned long long)line.unrequested, line.name);
+    }
+
+    if (!n)
+    {
+        return;
+    }
+
+    fprintf(f,
+        "Latency in cycles: min %llu, average %.2f, max %llu\n"
+        "\n"
+        "   latency      count      %%\n",
+        (unsigned long long)histogram.begin()->first,
+        (double)total / n,
+        (unsigned long long)histogram.rbegin()->first);
+
+    for (std::map<uint64_t, uint64_t>::const_iterator it = histogram.begin();
+        it != histogram.end(); ++it)
+    {
+        fprintf(f, "%10llu %10llu %6.2f\n",
+            (unsigned long long)it->first, (unsigned long long)it->second,
+            100.0 * it->second / n);
+    }
+
+    // The stable sort keeps requests with the same latency in trace order
+    std::stable_sort(worst.begin(), worst.end(), ByLatency);
+
+    fprintf(f,
+        "\n"
+        "Longest (top %u)\n"
+        "   latency  request   interrupted\n", top);
+
+    for (size_t u = 0; (u < worst.size()) && (u < top); u++)
+    {
+        fprintf(f, "%10llu  %08llX  $%04X\n",
+            (unsigned long long)worst[u]->latency,
+            (unsigned long long)worst[u]->cycle,
+            worst[u]->pc);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Print the report
+void LatencyMeter::Report(
+    FILE *f,
+    unsigned top)
+{
+    fprintf(f, "Interrupt latency (from request to vector fetch)\n\n");
+    ReportLine(f, m_irq, top);
+    fprintf(f, "\n");
+    ReportLine(f, m_nmi, top);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
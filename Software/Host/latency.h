@@ -0,0 +1,121 @@
+/*
+ * latency.h
+ *
+ * Measuring interrupt latency from a trace with signals
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "decoder.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Interrupt latency meter
+//
+// An interrupt request starts at the first cycle where the IRQ or NMI
+// signal is active after a cycle where it was inactive. The latency is the
+// number of cycles from there to the first vector fetch of the interrupt
+// sequence that handles it.
+//
+// IRQ is level-triggered: if it's released before the 6502 starts the
+// interrupt sequence (usually because interrupts were disabled), the
+// request is counted as dropped. NMI is edge-triggered, so a request is
+// never dropped.
+class LatencyMeter
+{
+public:
+    LatencyMeter(
+        TraceWindow &window);           // Cycles with signals
+
+    void Add(
+        const Instruction &instr);      // Decoded instruction
+
+    void Report(
+        FILE *f,                        // Output file
+        unsigned top);                  // Num of worst requests shown
+
+private:
+    // Serviced request
+    struct Sample
+    {
+        uint64_t cycle;                 // Cycle where the request started
+        uint64_t latency;               // Cycles until the vector fetch
+        uint16_t pc;                    // Address of interrupted instruction
+    };
+
+    // State and statistics of an interrupt line
+    struct Line
+    {
+        const char         *name;
+        uint32_t            mask;       // Signal in the trace long
+        bool                level;      // Edge-triggered if false
+        bool                active;     // Signal in previous cycle
+        bool                pending;    // Request not serviced yet
+        uint64_t            start;      // Cycle where request started
+        uint64_t            dropped;    // Requests released before service
+        uint64_t            unrequested; // Interrupts without request
+        std::vector<Sample> samples;
+    };
+
+    static bool ByLatency(const Sample *a, const Sample *b);
+    void Update(Line &line, uint32_t raw, uint64_t cycle);
+    void Service(Line &line, const Instruction &instr);
+    void ReportLine(FILE *f, Line &line, unsigned top);
+
+    TraceWindow &m_window;
+    Line         m_irq;
+    Line         m_nmi;
+    bool         m_started;             // Signals of first cycle are known
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,615 @@
+/*
+ * profile.cpp
+ *
+ * Profiling 65C02 code from the decoded instructions of a trace
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "profile.h"
+#include "disasm.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Maximum depth of the shadow stack. The 6502 stack holds at most 128
+// return addresses; the rest are calls that never returned.
+#define PROFILE_MAX_DEPTH   (256)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+Profiler::Profiler()
+    : m_pc(65536)
+    , m_block(65536)
+    , m_entry(65536)
+    , m_inBlock(false)
+    , m_blockStart(0)
+    , m_last(0)
+    , m_cycles(0)
+    , m_instructions(0)
+    , m_unknown(0)
+    , m_unmatched(0)
+{
+}
+
+
+//---------------------------------------------------------------------------
+// Parse an address in a label file
+//
+// Returns true if the text is a hexadecimal number. If prefixed is true,
+// the number must start with $, 0x or C: (as in VICE label files).
+static bool ParseAddress(
+    const char *text,
+    bool prefixed,
+    unsigned &addr)
+{
+    if (text[0] == '$')
+    {
+        text++;
+    }
+    else if ((text[0] == '0') && (tolower(text[1]) == 'x'))
+    {
+        text += 2;
+    }
+    else if ((toupper(text[0]) == 'C') && (text[1] == ':'))
+    {
+        text += 2;
+    }
+    else if (prefixed)
+    {
+        return false;
+    }
+
+    if (!*text || (strspn(text, "0123456789ABCDEFabcdef") != strlen(text)))
+    {
+        return false;
+    }
+
+    addr = (unsigned)strtoul(text, NULL, 16) & 0xFFFF;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Load a label file
+//
+// Each line has a name and an address, in any of these forms:
+//   al C:C000 .reset           (VICE, e.g. from ld65 -Ln)
+//   reset = $C000
+//   reset EQU $C000
+//   C000 reset
+// Text after a semicolon is ignored.
+bool Profiler::LoadLabels(
+    const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    char line[256];
+
+    if (!f)
+    {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        std::vector<char *> tokens;
+        unsigned addr = 0;
+        int found = -1;
+
+        if (char *p = strchr(line, ';'))
+        {
+            *p = '\0';
+        }
+
+        for (char *p = strtok(line, " \t\r\n="); p; p = strtok(NULL, " \t\r\n="))
+        {
+            if (strcmp(p, "al") && strcasecmp(p, "equ") && strcasecmp(p, ".equ"))
+            {
+                tokens.push_back(p);
+            }
+        }
+
+        // Prefer a prefixed number, because a name can look like a number
+        for (int pass = 0; (pass < 2) && (found < 0); pass++)
+        {
+            for (size_t u = 0; u < tokens.size(); u++)
+            {
+                if (ParseAddress(tokens[u], !pass, addr))
+                {
+                    found = (int)u;
+                    break;
+                }
+            }
+        }
+
+        if ((found < 0) || (tokens.size() < 2))
+        {
+            continue;
+        }
+
+        char *name = tokens[found ? 0 : 1];
+        size_t len;
+
+        if (*name == '.')
+        {
+            name++;
+        }
+
+        len = strlen(name);
+        if (len && (name[len - 1] == ':'))
+        {
+            name[len - 1] = '\0';
+        }
+
+        // Keep the first name for each address
+        if (*name && !m_labels.count((uint16_t)addr))
+        {
+            m_labels[(uint16_t)addr] = name;
+            m_entry[addr] = true;
+        }
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the name of an address
+std::string Profiler::Name(
+    uint16_t addr) const
+{
+    std::map<uint16_t, std::string>::const_iterator it = m_labels.find(addr);
+    char text[8];
+
+    if (it != m_labels.end())
+    {
+        return it->second;
+    }
+
+    sprintf(text, "$%04X", addr);
+
+    return text;
+}
+
+
+//---------------------------------------------------------------------------
+// Push a call on the shadow stack
+void Profiler::Call(
+    uint16_t from,
+    uint16_t to,
+    uint16_t ret,
+    uint64_t cycle)
+{
+    Edge &edge = m_edges[((uint32_t)from << 16) | to];
+    Frame frame = { ret, cycle, &edge };
+
+    edge.calls++;
+    m_entry[to] = true;
+
+    if (m_stack.size() >= PROFILE_MAX_DEPTH)
+    {
+        m_stack.erase(m_stack.begin());
+    }
+
+    m_stack.push_back(frame);
+}
+
+
+//---------------------------------------------------------------------------
+// Pop the shadow stack for a return to the given address
+//
+// Frames above the one that matches are calls that were abandoned (e.g.
+// by pulling the return address off the stack); they end here too.
+void Profiler::Return(
+    uint16_t to,
+    uint64_t cycle)
+{
+    size_t u = m_stack.size();
+
+    while (u && (m_stack[u - 1].ret != to))
+    {
+        u--;
+    }
+
+    if (!u)
+    {
+        m_unmatched++;
+        return;
+    }
+
+    for (size_t v = u - 1; v < m_stack.size(); v++)
+    {
+        m_stack[v].pEdge->inclusive += cycle - m_stack[v].start;
+    }
+
+    m_stack.resize(u - 1);
+}
+
+
+//---------------------------------------------------------------------------
+// Add an instruction to the profile
+void Profiler::Add(
+    const Instruction &instr)
+{
+    uint64_t end = instr.cycle + instr.numCycles;
+
+    m_last = end;
+
+    switch (instr.kind)
+    {
+    case INSTR_NORMAL:
+        if (!instr.complete)
+        {
+            // The trace ended during the instruction, so its operands and
+            // its effect on the stack aren't known
+            m_unknown += instr.numCycles;
+            return;
+        }
+        break;
+
+    case INSTR_IRQ:
+    case INSTR_NMI:
+        // The cycles of the interrupt sequence count for the handler
+        m_cycles += instr.numCycles;
+        m_pc[instr.nextPC].entry += instr.numCycles;
+        Call(instr.pc, instr.nextPC, instr.pc, instr.cycle);
+        m_inBlock = false;
+        return;
+
+    case INSTR_RESET:
+        m_cycles += instr.numCycles;
+        m_pc[instr.nextPC].entry += instr.numCycles;
+        m_entry[instr.nextPC] = true;
+        m_stack.clear();
+        m_inBlock = false;
+        return;
+
+    default:
+        // Whatever happened during these cycles, the stack can't be trusted
+        m_unknown += instr.numCycles;
+        m_stack.clear();
+        m_inBlock = false;
+        return;
+    }
+
+    const OpcodeInfo &op = g_opcodes[instr.bytes[0]];
+    PcStats &s = m_pc[instr.pc];
+
+    if (!s.count)
+    {
+        memcpy(s.bytes, instr.bytes, sizeof(s.bytes));
+    }
+
+    s.count++;
+    s.cycles += instr.numCycles;
+    s.extra += instr.extra;
+
+    m_cycles += instr.numCycles;
+    m_instructions++;
+
+    switch (op.flow)
+    {
+    case FLOW_BRANCH:
+    case FLOW_BRA:
+        // A taken branch takes one more cycle, and one more if the target
+        // is in another page
+        if (instr.taken)
+        {
+            s.taken++;
+            if (instr.extra > 1)
+            {
+                s.cross++;
+            }
+        }
+        break;
+
+    case FLOW_NONE:
+        // Indexed reads take one more cycle if they cross a page. For ADC
+        // and SBC, the extra cycle can also be for decimal mode, so it
+        // only counts as a page crossing with an indexed mode.
+        if (instr.extra
+            && ((op.mode == MODE_ABX) || (op.mode == MODE_ABY)
+            || (op.mode == MODE_IZY)))
+        {
+            s.cross++;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // Basic blocks
+    if (!m_inBlock)
+    {
+        m_inBlock = true;
+        m_blockStart = instr.pc;
+        m_block[instr.pc].count++;
+    }
+
+    m_block[m_blockStart].cycles += instr.numCycles;
+    m_block[m_blockStart].instructions++;
+
+    if (op.flow != FLOW_NONE)
+    {
+        m_inBlock = false;
+    }
+
+    // Call graph
+    switch (op.flow)
+    {
+    case FLOW_JSR:
+        Call(instr.pc, instr.nextPC, (uint16_t)(instr.pc + 3), instr.cycle);
+        break;
+
+    case FLOW_BRK:
+        Call(instr.pc, instr.nextPC, (uint16_t)(instr.pc + 2), instr.cycle);
+        break;
+
+    case FLOW_RTS:
+    case FLOW_RTI:
+        Return(instr.nextPC, end);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Helper to sort addresses by a number of cycles, highest first
+struct ByCycles
+{
+    const std::vector<uint64_t> &cycles;
+
+    bool operator()(unsigned a, unsigned b) const
+    {
+        return (cycles[a] != cycles[b]) ? (cycles[a] > cycles[b]) : (a < b);
+    }
+};
+
+
+//---------------------------------------------------------------------------
+// Print the profile
+void Profiler::Report(
+    FILE *f,
+    unsigned top)
+{
+    double total = m_cycles ? (double)m_cycles : 1.0;
+    std::vector<uint16_t> routineOf(65536);
+    std::vector<uint64_t> self(65536);
+    std::vector<uint64_t> incl(65536);
+    std::vector<uint64_t> calls(65536);
+    std::vector<uint64_t> sortKey(65536);
+    std::vector<unsigned> order;
+    uint16_t routine = 0;
+
+    // Find the routine of each address. Code below the first routine
+    // entry counts as a routine at $0000.
+    for (unsigned u = 0; u < 65536; u++)
+    {
+        if (m_entry[u])
+        {
+            routine = (uint16_t)u;
+        }
+
+        routineOf[u] = routine;
+        self[routine] += m_pc[u].cycles + m_pc[u].entry;
+    }
+
+    // Calls that haven't returned count until the end of the trace
+    for (size_t v = 0; v < m_stack.size(); v++)
+    {
+        m_stack[v].pEdge->inclusive += m_last - m_stack[v].start;
+    }
+
+    m_stack.clear();
+
+    std::map<uint32_t, Edge> graph;
+
+    for (std::map<uint32_t, Edge>::const_iterator it = m_edges.begin();
+        it != m_edges.end(); ++it)
+    {
+        uint16_t to = (uint16_t)it->first;
+        Edge &e = graph[((uint32_t)routineOf[it->first >> 16] << 16) | to];
+
+        e.calls += it->second.calls;
+        e.inclusive += it->second.inclusive;
+        calls[to] += it->second.calls;
+        incl[to] += it->second.inclusive;
+    }
+
+    fprintf(f,
+        "%llu cycles, %llu instructions, %llu cycles not decoded\n",
+        (unsigned long long)m_cycles,
+        (unsigned long long)m_instructions,
+        (unsigned long long)m_unknown);
+
+    // Flat profile by routine
+    fprintf(f,
+        "\n"
+        "Routines\n"
+        "      self      %%   inclusive      calls  routine\n");
+
+    for (unsigned u = 0; u < 65536; u++)
+    {
+        if (self[u] || calls[u])
+        {
+            order.push_back(u);
+        }
+    }
+
+    ByCycles bySelf = { self };
+    std::sort(order.begin(), order.end(), bySelf);
+
+    for (size_t v = 0; v < order.size(); v++)
+    {
+        unsigned u = order[v];
+        char text[24];
+
+        // The inclusive count is measured from the calls, so it's unknown
+        // for routines that were never called (such as the top level)
+        if (calls[u])
+        {
+            sprintf(text, "%llu", (unsigned long long)incl[u]);
+        }
+        else
+        {
+            sprintf(text, "-");
+        }
+
+        fprintf(f, "%10llu %6.2f %11s %10llu  %s\n",
+            (unsigned long long)self[u], 100.0 * self[u] / total,
+            text, (unsigned long long)calls[u],
+            Name((uint16_t)u).c_str());
+    }
+
+    // Call graph
+    fprintf(f,
+        "\n"
+        "Call graph (estimated from JSR/RTS, BRK and interrupts)\n"
+        "     calls   inclusive  caller -> callee\n");
+
+    std::vector<std::pair<uint64_t, uint32_t> > edges;
+
+    for (std::map<uint32_t, Edge>::const_iterator it = graph.begin();
+        it != graph.end(); ++it)
+    {
+        edges.push_back(std::make_pair(~it->second.inclusive, it->first));
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t v = 0; v < edges.size(); v++)
+    {
+        const Edge &e = graph[edges[v].second];
+
+        fprintf(f, "%10llu %11llu  %s -> %s\n",
+            (unsigned long long)e.calls, (unsigned long long)e.inclusive,
+            Name((uint16_t)(edges[v].second >> 16)).c_str(),
+            Name((uint16_t)edges[v].second).c_str());
+    }
+
+    if (m_unmatched)
+    {
+        fprintf(f, "%llu returns didn't match a call\n",
+            (unsigned long long)m_unmatched);
+    }
+
+    // Basic blocks
+    fprintf(f,
+        "\n"
+        "Basic blocks (top %u)\n"
+        "     count      cycles      %%  instr  start  routine\n", top);
+
+    order.clear();
+    for (unsigned u = 0; u < 65536; u++)
+    {
+        sortKey[u] = m_block[u].cycles;
+        if (sortKey[u])
+        {
+            order.push_back(u);
+        }
+    }
+
+    ByCycles byBlock = { sortKey };
+    std::sort(order.begin(), order.end(), byBlock);
+
+    for (size_t v = 0; (v < order.size()) && (v < top); v++)
+    {
+        const BlockStats &b = m_block[order[v]];
+
+        fprintf(f, "%10llu %11llu %6.2f %6.2f  $%04X  %s\n",
+            (unsigned long long)b.count, (unsigned long long)b.cycles,
+            100.0 * b.cycles / total, (double)b.instructions / b.count,
+            order[v], Name(routineOf[order[v]]).c_str());
+    }
+
+    // Instructions
+    fprintf(f,
+        "\n"
+        "Instructions (top %u)\n"
+        "     count      cycles      %%      extra      taken      cross"
+        "  address  instruction\n", top);
+
+    order.clear();
+    for (unsigned u = 0; u < 65536; u++)
+    {
+        sortKey[u] = m_pc[u].cycles;
+        if (sortKey[u])
+        {
+            order.push_back(u);
+        }
+    }
+
+    ByCycles byPc = { sortKey };
+    std::sort(order.begin(), order.end(), byPc);
+
+    for (size_t v = 0; (v < order.size()) && (v < top); v++)
+    {
+        const PcStats &s = m_pc[order[v]];
+        char text[32];
+
+        Disassemble(text, (uint16_t)order[v], s.bytes);
+        fprintf(f, "%10llu %11llu %6.2f %10llu %10llu %10llu  $%04X    %s\n",
+            (unsigned long long)s.count, (unsigned long long)s.cycles,
+            100.0 * s.cycles / total, (unsigned long long)s.extra,
+            (unsigned long long)s.taken, (unsigned long long)s.cross,
+            order[v], text);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,149 @@
+/*
+ * profile.h
+ *
+ * Profiling 65C02 code from the decoded instructions of a trace
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "decoder.h"
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Profiler
+//
+// Cycles are counted per instruction address and per dynamic basic block
+// (a run of instructions that ends with a branch, jump, call, return or
+// interrupt). At the end, the cycles of each address are added to the
+// routine that contains it: the nearest routine entry at or below it.
+// Routine entries are the labels from a label file, plus the targets of
+// JSR instructions and interrupts that were seen in the trace.
+//
+// The call graph is an estimate: a shadow stack follows JSR and interrupts,
+// and RTS and RTI are matched to it by their return address. Code that
+// manipulates the stack in other ways can make the inclusive cycle counts
+// inaccurate, and recursive calls are counted more than once.
+class Profiler
+{
+public:
+    Profiler();
+
+    bool                                // Returns false if file can't open
+    LoadLabels(
+        const char *filename);          // Label file
+
+    void Add(
+        const Instruction &instr);      // Decoded instruction
+
+    void Report(
+        FILE *f,                        // Output file
+        unsigned top);                  // Num of blocks, instructions shown
+
+private:
+    // Statistics per instruction address
+    struct PcStats
+    {
+        uint64_t count;                 // Number of times executed
+        uint64_t cycles;
+        uint64_t extra;                 // Cycles over the minimum
+        uint64_t taken;                 // Taken branches
+        uint64_t cross;                 // Page crossing penalties
+        uint64_t entry;                 // Cycles of interrupt entry here
+        uint8_t  bytes[3];              // Instruction, as first seen
+    };
+
+    // Statistics per basic block, indexed by start address
+    struct BlockStats
+    {
+        uint64_t count;                 // Number of times executed
+        uint64_t cycles;
+        uint64_t instructions;
+    };
+
+    // Call graph edge
+    struct Edge
+    {
+        uint64_t calls;
+        uint64_t inclusive;             // Cycles until return
+    };
+
+    // Frame on the shadow stack
+    struct Frame
+    {
+        uint16_t ret;                   // Address where the call returns
+        uint64_t start;                 // Cycle where the call starts
+        Edge    *pEdge;
+    };
+
+    void Call(uint16_t from, uint16_t to, uint16_t ret, uint64_t cycle);
+    void Return(uint16_t to, uint64_t cycle);
+    std::string Name(uint16_t addr) const;
+
+    std::vector<PcStats>           m_pc;
+    std::vector<BlockStats>        m_block;
+    std::map<uint16_t, std::string> m_labels;
+    std::vector<bool>              m_entry;     // Routine entry points
+    std::map<uint32_t, Edge>       m_edges;     // Key: from << 16 | to
+    std::vector<Frame>             m_stack;
+    bool                           m_inBlock;
+    uint16_t                       m_blockStart;
+    uint64_t                       m_last;      // End of last instruction
+    uint64_t                       m_cycles;
+    uint64_t                       m_instructions;
+    uint64_t                       m_unknown;   // Cycles not decoded
+    uint64_t                       m_unmatched; // Returns not on the stack
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
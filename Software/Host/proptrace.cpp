@@ -0,0 +1,1248 @@
+/*
+ * proptrace.cpp
+ *
+ * Host tool for trace dumps of the PropeddleTrace module
+ *
+ * Build with a C++11 compiler, e.g.:
+ *   g++ -O2 -o proptrace *.cpp
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "decoder.h"
+#include "disasm.h"
+#include "latency.h"
+#include "profile.h"
+#include "trace.h"
+#include "stream.h"
+#include "vcd.h"
+#include "verify.h"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Default speed of the serial port for the capture command
+#define DEFAULT_BAUD (2000000)
+
+// Default number of lines in the lists of the profile command
+#define DEFAULT_TOP (20)
+
+// Default cycle time in ns for the vcd command (1MHz)
+#define DEFAULT_PERIOD (1000)
+
+// Maximum number of memory images and excluded ranges for verify
+#define MAX_RANGES (16)
+
+// Size of the output buffer; text output can be many gigabytes
+#define OUTPUT_BUFFER (1 << 20)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Command line options
+struct Options
+{
+    const char *command;
+    const char *input;
+    const char *output;
+    bool        compressed;             // Input is in the compressed format
+    bool        filtered;               // Input is in the filtered format
+    bool        wide;                   // Input is in the wide format
+    bool        signals;                // Input is in the signals format
+    unsigned    baud;                   // Serial port speed for capture
+    unsigned    delay;                  // Data delay in cycles
+    const char *labels;                 // Label file for profile
+    unsigned    top;                    // Lines in profile lists
+    unsigned    budget;                 // Clocks per cycle, 0=most common
+    unsigned    period;                 // Cycle time in ns for vcd
+    const char *images[MAX_RANGES];     // Memory images for verify
+    unsigned    numImages;
+    const char *excludes[MAX_RANGES];   // Excluded ranges for verify
+    unsigned    numExcludes;
+};
+
+
+//---------------------------------------------------------------------------
+// Output file and statistics for the capture command
+struct Capture
+{
+    FILE       *f;
+    uint64_t    cycles;                 // Cycles written to the file
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DATA
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Set by the signal handler to stop capturing
+static volatile sig_atomic_t s_stop;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Show usage and exit
+static void Usage()
+{
+    fprintf(stderr,
+        "Usage: proptrace [options] command input [output]\n"
+        "\n"
+        "Commands:\n"
+        "  dump      Print each cycle as text\n"
+        "  expand    Convert to the normal binary format\n"
+        "  decode    Print each cycle with its bus operation, and the\n"
+        "            disassembled instruction at each opcode fetch\n"
+        "  disasm    Print each instruction with its number of cycles\n"
+        "  profile   Print where the cycles are spent, by routine, basic\n"
+        "            block and instruction, and a call graph\n"
+        "  latency   Print the interrupt latency; the input must be in the\n"
+        "            signals format\n"
+        "  vcd       Convert to a Value Change Dump for waveform viewers,\n"
+        "            with address, data, R/W, SYNC (derived from the decoded\n"
+        "            instructions) and the signals if the input has them\n"
+        "  timing    Print a histogram of the number of Propeller clocks per\n"
+        "            cycle, and the cycles that took longer than the budget;\n"
+        "            the input must be in the wide format\n"
+        "  verify    Run a model of the 65C02 in lockstep with the trace, and\n"
+        "            report the first cycle where the bus differs from it\n"
+        "  capture   Receive a stream from PropeddleStream; the input is the\n"
+        "            serial port (e.g. /dev/ttyUSB0). Stop with Ctrl-C.\n"
+        "\n"
+        "Options:\n"
+        "  -c        Input is in the compressed format (StartCompressed)\n"
+        "  -f        Input is in the filtered format (StartFiltered); only\n"
+        "            the dump command can be used\n"
+        "  -w        Input is in the wide format (StartWide)\n"
+        "  -s        Input is in the signals format (StartSignals); dump\n"
+        "            shows the active signals of each cycle\n"
+        "  -b baud   Serial port speed for capture (default %u)\n"
+        "  -d n      Take the data of each cycle from n cycles later, for\n"
+        "            traces where the data bus was stored with a delay\n"
+        "  -l file   Label file for profile (e.g. from ld65 -Ln)\n"
+        "  -n n      Number of blocks and instructions in profile, or of\n"
+        "            longest latencies (default %u)\n"
+        "  -t n      Budget for timing in Propeller clocks per cycle\n"
+        "            (default: the most common number)\n"
+        "  -p ns     Cycle time for vcd (default %u)\n"
+        "  -m a:file Memory image at hex address a for verify, e.g. the\n"
+        "            ROM; can be used more than once\n"
+        "  -x a-b    Hex address range where verify doesn't check the data\n"
+        "            of reads, e.g. I/O; can be used more than once\n"
+        "\n"
+        "Input and output file names can be - for stdin and stdout.\n",
+        DEFAULT_BAUD, DEFAULT_TOP, DEFAULT_PERIOD);
+
+    exit(2);
+}
+
+
+//---------------------------------------------------------------------------
+// Parse the command line
+static void ParseArgs(
+    int argc,
+    char *argv[],
+    Options &opt)
+{
+    int n = 0;
+
+    memset(&opt, 0, sizeof(opt));
+    opt.output = "-";
+    opt.baud = DEFAULT_BAUD;
+    opt.top = DEFAULT_TOP;
+    opt.period = DEFAULT_PERIOD;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+
+        if ((arg[0] == '-') && arg[1])
+        {
+            if (!strcmp(arg, "-c"))
+            {
+                opt.compressed = true;
+            }
+            else if (!strcmp(arg, "-f"))
+            {
+                opt.filtered = true;
+            }
+            else if (!strcmp(arg, "-w"))
+            {
+                opt.wide = true;
+            }
+            else if (!strcmp(arg, "-s"))
+            {
+                opt.signals = true;
+            }
+            else if (!strcmp(arg, "-b") && (i + 1 < argc))
+            {
+                opt.baud = (unsigned)strtoul(argv[++i], NULL, 0);
+            }
+            else if (!strcmp(arg, "-d") && (i + 1 < argc))
+            {
+                opt.delay = (unsigned)strtoul(argv[++i], NULL, 0);
+            }
+            else if (!strcmp(arg, "-l") && (i + 1 < argc))
+            {
+                opt.labels = argv[++i];
+            }
+            else if (!strcmp(arg, "-n") && (i + 1 < argc))
+            {
+                opt.top = (unsigned)strtoul(argv[++i], NULL, 0);
+            }
+            else if (!strcmp(arg, "-t") && (i + 1 < argc))
+            {
+                opt.budget = (unsigned)strtoul(argv[++i], NULL, 0);
+            }
+            else if (!strcmp(arg, "-p") && (i + 1 < argc))
+            {
+                opt.period = (unsigned)strtoul(argv[++i], NULL, 0);
+            }
+            else if (!strcmp(arg, "-m") && (i + 1 < argc)
+                && (opt.numImages < MAX_RANGES))
+            {
+                opt.images[opt.numImages++] = argv[++i];
+            }
+            else if (!strcmp(arg, "-x") && (i + 1 < argc)
+                && (opt.numExcludes < MAX_RANGES))
+            {
+                opt.excludes[opt.numExcludes++] = argv[++i];
+            }
+            else
+            {
+                Usage();
+            }
+        }
+        else
+        {
+            switch (n++)
+            {
+            case 0: opt.command = arg; break;
+            case 1: opt.input   = arg; break;
+            case 2: opt.output  = arg; break;
+            default: Usage();
+            }
+        }
+    }
+
+    if (n < 2)
+    {
+        Usage();
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Open the output file
+static FILE *OpenOutput(
+    const char *filename,
+    const char *mode)
+{
+    FILE *f = strcmp(filename, "-") ? fopen(filename, mode) : stdout;
+
+    if (!f)
+    {
+        perror(filename);
+        exit(1);
+    }
+
+    setvbuf(f, NULL, _IOFBF, OUTPUT_BUFFER);
+
+    return f;
+}
+
+
+//---------------------------------------------------------------------------
+// Append a hexadecimal number to a text buffer
+static inline char *Hex(
+    char *p,
+    unsigned value,
+    unsigned digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (unsigned u = digits; u; u--)
+    {
+        p[u - 1] = hex[value & 15];
+        value >>= 4;
+    }
+
+    return p + digits;
+}
+
+
+//---------------------------------------------------------------------------
+// Append a string to a text buffer, padded with spaces
+static inline char *Pad(
+    char *p,
+    const char *s,
+    unsigned width)
+{
+    unsigned u = 0;
+
+    while (s[u])
+    {
+        p[u] = s[u];
+        u++;
+    }
+
+    while (u < width)
+    {
+        p[u++] = ' ';
+    }
+
+    return p + u;
+}
+
+
+//---------------------------------------------------------------------------
+// Append a cycle number to a text buffer, as at least 8 hex digits
+static inline char *HexCycle(
+    char *p,
+    uint64_t cycle)
+{
+    unsigned digits = 8;
+
+    while ((digits < 16) && (cycle >> (4 * digits)))
+    {
+        digits++;
+    }
+
+    for (unsigned u = digits; u > 8; u--)
+    {
+        *p++ = "0123456789ABCDEF"[(cycle >> (4 * (u - 1))) & 15];
+    }
+
+    return Hex(p, (unsigned)cycle, 8);
+}
+
+
+//---------------------------------------------------------------------------
+// Append the names of the active signals to a text buffer
+static char *Signals(
+    char *p,
+    uint32_t raw)
+{
+    static const struct
+    {
+        uint32_t    mask;
+        const char *name;
+    }   signals[] =
+    {
+        { TRACE_SIG_RES,   " RES"   },
+        { TRACE_SIG_NRDY,  " NRDY"  },
+        { TRACE_SIG_SO,    " SO"    },
+        { TRACE_SIG_IRQ,   " IRQ"   },
+        { TRACE_SIG_NBE,   " NBE"   },
+        { TRACE_SIG_NMI,   " NMI"   },
+        { TRACE_SIG_SETUP, " SETUP" },
+    };
+
+    for (unsigned u = 0; u < sizeof(signals) / sizeof(signals[0]); u++)
+    {
+        if (raw & signals[u].mask)
+        {
+            p = Pad(p, signals[u].name, 0);
+        }
+    }
+
+    return p;
+}
+
+
+//---------------------------------------------------------------------------
+// Print each cycle as text
+//
+// The format is the same as the dumptrace function in the Spin code. For
+// the signals format, the active signals are added to each line.
+static void Dump(
+    TraceSource &source,
+    bool signals,
+    FILE *f)
+{
+    uint32_t raw;
+    uint64_t cycle = 0;
+
+    char line[64];
+
+    while (source.Next(raw))
+    {
+        TraceRecord r = { raw };
+        char *p = HexCycle(line, cycle++);
+
+        *p++ = ':';
+        *p++ = ' ';
+        *p++ = r.IsRead() ? 'R' : 'W';
+        *p++ = ' ';
+        p = Hex(p, r.Addr(), 4);
+        *p++ = ' ';
+        p = Hex(p, r.Data(), 2);
+        if (signals)
+        {
+            p = Signals(p, raw);
+        }
+        *p++ = '\n';
+        fwrite(line, 1, (size_t)(p - line), f);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Print each stored cycle of a filtered trace as text
+//
+// The format is the same as for the dump command, but the cycle numbers
+// count the cycles that weren't stored.
+static void DumpFiltered(
+    FilteredReader &source,
+    FILE *f)
+{
+    uint64_t cycle;
+    uint32_t raw;
+    char line[32];
+
+    while (source.Next(cycle, raw))
+    {
+        TraceRecord r = { raw };
+        char *p = HexCycle(line, cycle);
+
+        *p++ = ':';
+        *p++ = ' ';
+        *p++ = r.IsRead() ? 'R' : 'W';
+        *p++ = ' ';
+        p = Hex(p, r.Addr(), 4);
+        *p++ = ' ';
+        p = Hex(p, r.Data(), 2);
+        *p++ = '\n';
+        fwrite(line, 1, (size_t)(p - line), f);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Write each cycle in the normal binary format
+static void Expand(
+    TraceSource &source,
+    FILE *f)
+{
+    uint32_t raw;
+
+    while (source.Next(raw))
+    {
+        uint8_t b[4] =
+        {
+            (uint8_t)raw, (uint8_t)(raw >> 8),
+            (uint8_t)(raw >> 16), (uint8_t)(raw >> 24)
+        };
+
+        fwrite(b, 1, sizeof(b), f);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Format a decoded instruction: address, bytes and disassembly
+//
+// Returns the end of the text, which is not terminated.
+static char *FormatInstruction(
+    char *p,
+    const Instruction &instr)
+{
+    static const char *kinds[] = { "", "IRQ", "NMI", "RESET", "" };
+
+    if (instr.kind == INSTR_UNKNOWN)
+    {
+        return p + sprintf(p, "----  (%u unknown cycles)", instr.numCycles);
+    }
+
+    if (instr.kind != INSTR_NORMAL)
+    {
+        return p + sprintf(p, "%04X  %-8s  -> $%04X",
+            instr.pc, kinds[instr.kind], instr.nextPC);
+    }
+
+    unsigned len = g_opcodes[instr.bytes[0]].len;
+    char text[32];
+
+    p = Hex(p, instr.pc, 4);
+    *p++ = ' ';
+    *p++ = ' ';
+
+    for (unsigned u = 0; u < 3; u++)
+    {
+        if (u < instr.numBytes)
+        {
+            p = Hex(p, instr.bytes[u], 2);
+        }
+        else if (u < len)
+        {
+            // The trace ended before this byte was read
+            *p++ = '?';
+            *p++ = '?';
+        }
+        else
+        {
+            *p++ = ' ';
+            *p++ = ' ';
+        }
+
+        *p++ = ' ';
+    }
+
+    *p++ = ' ';
+
+    if (instr.numBytes < len)
+    {
+        sprintf(text, "%s ??", g_opcodes[instr.bytes[0]].mnemonic);
+    }
+    else
+    {
+        Disassemble(text, instr.pc, instr.bytes);
+    }
+
+    return Pad(p, text, 0);
+}
+
+
+//---------------------------------------------------------------------------
+// Print each cycle with its bus operation
+//
+// The format starts the same as the dump command. The disassembled
+// instruction is printed on the first line of each instruction.
+static void Decode(
+    TraceSource &source,
+    unsigned delay,
+    FILE *f)
+{
+    static const char *roles[] =
+    {
+        "?", "fetch", "operand", "read", "write", "stack", "vector"
+    };
+
+    TraceWindow window(source, delay);
+    Decoder decoder(window);
+    Instruction instr;
+    char line[128];
+
+    while (decoder.Next(instr))
+    {
+        for (uint64_t c = instr.cycle; c < instr.cycle + instr.numCycles; c++)
+        {
+            TraceRecord r;
+            char *p = line;
+
+            window.Get(c, r);
+
+            p = HexCycle(p, c);
+            *p++ = ':';
+            *p++ = ' ';
+            *p++ = r.IsRead() ? 'R' : 'W';
+            *p++ = ' ';
+            p = Hex(p, r.Addr(), 4);
+            *p++ = ' ';
+            p = Hex(p, r.Data(), 2);
+            *p++ = ' ';
+            *p++ = ' ';
+            p = Pad(p, roles[Decoder::Role(instr, c, r)], 8);
+
+            if (c == instr.cycle)
+            {
+                p = FormatInstruction(p, instr);
+            }
+
+            // Remove trailing spaces
+            while (p[-1] == ' ')
+            {
+                p--;
+            }
+
+            *p++ = '\n';
+            fwrite(line, 1, (size_t)(p - line), f);
+        }
+
+        if (!instr.complete)
+        {
+            fprintf(f, "(trace ends during instruction)\n");
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Print each instruction with its number of cycles
+static void Disasm(
+    TraceSource &source,
+    unsigned delay,
+    FILE *f)
+{
+    TraceWindow window(source, delay);
+    Decoder decoder(window);
+    Instruction instr;
+    char line[128];
+
+    while (decoder.Next(instr))
+    {
+        char *p = line;
+
+        p = HexCycle(p, instr.cycle);
+        *p++ = ':';
+        *p++ = ' ';
+        p = FormatInstruction(p, instr);
+
+        if (instr.kind != INSTR_UNKNOWN)
+        {
+            char *q = line + 50;
+
+            // Line up the cycle counts
+            while (p < q)
+            {
+                *p++ = ' ';
+            }
+
+            p += sprintf(p, " %2u", instr.numCycles);
+
+            if (instr.taken)
+            {
+                p = Pad(p, " taken", 0);
+            }
+
+            if (!instr.complete)
+            {
+                p = Pad(p, " (incomplete)", 0);
+            }
+        }
+
+        *p++ = '\n';
+        fwrite(line, 1, (size_t)(p - line), f);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Print a profile
+static int Profile(
+    TraceSource &source,
+    const Options &opt,
+    FILE *f)
+{
+    TraceWindow window(source, opt.delay);
+    Decoder decoder(window);
+    Profiler profiler;
+    Instruction instr;
+
+    if (opt.labels && !profiler.LoadLabels(opt.labels))
+    {
+        perror(opt.labels);
+        return 1;
+    }
+
+    while (decoder.Next(instr))
+    {
+        profiler.Add(instr);
+    }
+
+    profiler.Report(f, opt.top);
+
+    return 0;
+}
+
+
+//---------------------------------------------------------------------------
+// Write a Value Change Dump
+//
+// SYNC is high during the first cycle of each instruction and interrupt
+// sequence (which starts with an opcode fetch that's discarded), and
+// unknown for cycles that couldn't be decoded.
+static void Vcd(
+    TraceSource &source,
+    const Options &opt,
+    FILE *f)
+{
+    TraceWindow window(source, opt.delay);
+    Decoder decoder(window);
+    VcdWriter writer(f, opt.signals, opt.period);
+    Instruction instr;
+
+    while (decoder.Next(instr))
+    {
+        for (uint64_t c = instr.cycle; c < instr.cycle + instr.numCycles; c++)
+        {
+            TraceRecord r;
+            VcdSync sync = VCD_SYNC_LOW;
+
+            if (!window.Get(c, r))
+            {
+                break;
+            }
+
+            if (instr.kind == INSTR_UNKNOWN)
+            {
+                sync = VCD_SYNC_UNKNOWN;
+            }
+            else if ((c == instr.cycle) && (instr.kind != INSTR_RESET))
+            {
+                sync = VCD_SYNC_HIGH;
+            }
+
+            writer.Cycle(r, sync);
+        }
+    }
+
+    writer.Finish();
+}
+
+
+//---------------------------------------------------------------------------
+// Print the interrupt latency
+static void Latency(
+    TraceSource &source,
+    const Options &opt,
+    FILE *f)
+{
+    TraceWindow window(source, opt.delay);
+    Decoder decoder(window);
+    LatencyMeter meter(window);
+    Instruction instr;
+
+    while (decoder.Next(instr))
+    {
+        meter.Add(instr);
+    }
+
+    meter.Report(f, opt.top);
+}
+
+
+//---------------------------------------------------------------------------
+// Verify a trace against the 65C02 model
+//
+// Returns 1 if the trace diverges from the model, 2 for bad arguments.
+static int Verify(
+    TraceSource &source,
+    const Options &opt,
+    FILE *f)
+{
+    TraceWindow window(source, opt.delay);
+    Verifier verifier(window, opt.signals);
+    char *end;
+
+    for (unsigned u = 0; u < opt.numImages; u++)
+    {
+        unsigned addr = (unsigned)strtoul(opt.images[u], &end, 16);
+
+        if ((end == opt.images[u]) || (*end != ':') || (addr > 0xFFFF))
+        {
+            fprintf(stderr, "Bad memory image %s, expected addr:file\n",
+                opt.images[u]);
+            return 2;
+        }
+
+        if (!verifier.LoadImage(end + 1, (uint16_t)addr))
+        {
+            perror(end + 1);
+            return 2;
+        }
+    }
+
+    for (unsigned u = 0; u < opt.numExcludes; u++)
+    {
+        unsigned first = (unsigned)strtoul(opt.excludes[u], &end, 16);
+        unsigned last = first;
+
+        if ((end != opt.excludes[u]) && (*end == '-'))
+        {
+            last = (unsigned)strtoul(end + 1, &end, 16);
+        }
+
+        if ((end == opt.excludes[u]) || *end || (last < first)
+            || (last > 0xFFFF))
+        {
+            fprintf(stderr, "Bad range %s, expected first-last\n",
+                opt.excludes[u]);
+            return 2;
+        }
+
+        verifier.Exclude((uint16_t)first, (uint16_t)last);
+    }
+
+    return verifier.Run(f) ? 0 : 1;
+}
+
+
+//---------------------------------------------------------------------------
+// Print the timing of a wide trace
+//
+// A wide trace is never longer than the hub memory, so the cycles are kept
+// in memory until the budget is known.
+static void Timing(
+    WideReader &source,
+    unsigned budget,
+    FILE *f)
+{
+    std::map<uint32_t, uint64_t> histogram;
+    std::vector<uint32_t> raws;
+    std::vector<uint32_t> clocks;
+    uint64_t overruns = 0;
+    uint64_t over = 0;
+    uint64_t total = 0;
+    uint32_t raw;
+    char line[64];
+
+    while (source.Next(raw))
+    {
+        raws.push_back(raw);
+        clocks.push_back(source.Clocks());
+
+        // The last cycle has no duration
+        if (source.Clocks())
+        {
+            histogram[source.Clocks()]++;
+            total++;
+        }
+    }
+
+    if (!budget)
+    {
+        uint64_t most = 0;
+
+        for (std::map<uint32_t, uint64_t>::const_iterator it = histogram.begin();
+            it != histogram.end(); ++it)
+        {
+            if (it->second > most)
+            {
+                most = it->second;
+                budget = it->first;
+            }
+        }
+    }
+
+    for (size_t u = 0; u < clocks.size(); u++)
+    {
+        if (clocks[u] > budget)
+        {
+            overruns++;
+            over += clocks[u] - budget;
+        }
+    }
+
+    fprintf(f,
+        "Cycles:   %llu (%llu with a known number of clocks)\n"
+        "Budget:   %u clocks per cycle\n"
+        "Overruns: %llu cycles, %llu clocks over budget\n"
+        "\n"
+        "  Clocks        Cycles         %%\n",
+        (unsigned long long)raws.size(),
+        (unsigned long long)total,
+        budget,
+        (unsigned long long)overruns,
+        (unsigned long long)over);
+
+    for (std::map<uint32_t, uint64_t>::const_iterator it = histogram.begin();
+            it != histogram.end(); ++it)
+    {
+        fprintf(f, "%8u  %12llu  %7.3f%s\n",
+            it->first,
+            (unsigned long long)it->second,
+            100.0 * it->second / total,
+            (it->first > budget) ? "  over" : "");
+    }
+
+    if (!overruns)
+    {
+        return;
+    }
+
+    // List the overruns in the same format as the dump command
+    fprintf(f, "\nCycles over budget:\n");
+
+    for (size_t u = 0; u < clocks.size(); u++)
+    {
+        if (clocks[u] > budget)
+        {
+            TraceRecord r = { raws[u] };
+            char *p = HexCycle(line, u);
+
+            *p++ = ':';
+            *p++ = ' ';
+            *p++ = r.IsRead() ? 'R' : 'W';
+            *p++ = ' ';
+            p = Hex(p, r.Addr(), 4);
+            *p++ = ' ';
+            p = Hex(p, r.Data(), 2);
+            p += sprintf(p, "  %u clocks\n", clocks[u]);
+            fwrite(line, 1, (size_t)(p - line), f);
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Signal handler for Ctrl-C during capture
+static void OnSignal(
+    int)
+{
+    s_stop = 1;
+}
+
+
+//---------------------------------------------------------------------------
+// Open a serial port in raw mode
+//
+// Returns a file descriptor, or -1 on failure
+static int OpenSerial(
+    const char *device,
+    unsigned baud)
+{
+    static const struct
+    {
+        unsigned baud;
+        speed_t  speed;
+    }   speeds[] =
+    {
+        {   115200, B115200  },
+        {   230400, B230400  },
+        {   460800, B460800  },
+        {   921600, B921600  },
+        {  1000000, B1000000 },
+        {  1500000, B1500000 },
+        {  2000000, B2000000 },
+        {  3000000, B3000000 },
+    };
+
+    struct termios tio;
+    size_t u;
+    int fd;
+
+    for (u = 0; u < sizeof(speeds) / sizeof(speeds[0]); u++)
+    {
+        if (speeds[u].baud == baud)
+        {
+            break;
+        }
+    }
+
+    if (u == sizeof(speeds) / sizeof(speeds[0]))
+    {
+        fprintf(stderr, "Unsupported speed %u\n", baud);
+        return -1;
+    }
+
+    fd = open(device, O_RDONLY | O_NOCTTY);
+    if (fd < 0)
+    {
+        perror(device);
+        return -1;
+    }
+
+    if (tcgetattr(fd, &tio))
+    {
+        perror(device);
+        close(fd);
+        return -1;
+    }
+
+    // The stream cog sends 8 data bits, no parity and (at least) two stop
+    // bits; the receiver only needs one stop bit.
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speeds[u].speed);
+    cfsetospeed(&tio, speeds[u].speed);
+
+    if (tcsetattr(fd, TCSANOW, &tio))
+    {
+        perror(device);
+        close(fd);
+        return -1;
+    }
+
+    tcflush(fd, TCIFLUSH);
+
+    return fd;
+}
+
+
+//---------------------------------------------------------------------------
+// Store the longs of a frame
+static void OnFrame(
+    void *pContext,
+    const uint32_t *pLongs,
+    size_t numLongs,
+    uint64_t lostBefore)
+{
+    Capture *pCapture = static_cast<Capture *>(pContext);
+
+    if (lostBefore)
+    {
+        fprintf(stderr, "Lost %llu cycles after cycle %llu\n",
+            (unsigned long long)lostBefore,
+            (unsigned long long)pCapture->cycles);
+    }
+
+    for (size_t u = 0; u < numLongs; u++)
+    {
+        uint32_t raw = pLongs[u];
+        uint8_t b[4] =
+        {
+            (uint8_t)raw, (uint8_t)(raw >> 8),
+            (uint8_t)(raw >> 16), (uint8_t)(raw >> 24)
+        };
+
+        fwrite(b, 1, sizeof(b), pCapture->f);
+    }
+
+    pCapture->cycles += numLongs;
+}
+
+
+//---------------------------------------------------------------------------
+// Capture a stream from the serial port to a file
+//
+// Frames that were lost are reported on stderr; the output file has the
+// cycles of the good frames only, in the normal binary format.
+static int CaptureStream(
+    const Options &opt)
+{
+    Capture capture;
+    StreamParser parser(OnFrame, &capture);
+    uint8_t buf[4096];
+    time_t start;
+    int fd;
+
+    fd = OpenSerial(opt.input, opt.baud);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    capture.f = OpenOutput(opt.output, "wb");
+    capture.cycles = 0;
+
+    // Don't restart the read when Ctrl-C is pressed
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = OnSignal;
+    sigaction(SIGINT, &sa, NULL);
+    start = time(NULL);
+
+    while (!s_stop)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+
+        if (n > 0)
+        {
+            parser.Feed(buf, (size_t)n);
+        }
+        else if (n < 0)
+        {
+            break;
+        }
+    }
+
+    const StreamStats &stats = parser.Stats();
+    time_t seconds = time(NULL) - start;
+
+    fprintf(stderr,
+        "%llu frames, %llu cycles (%llu cycles/s)\n"
+        "%llu frames lost, %llu overruns, %llu bad checksums, %llu junk bytes\n",
+        (unsigned long long)stats.frames,
+        (unsigned long long)stats.longs,
+        (unsigned long long)(seconds ? stats.longs / seconds : stats.longs),
+        (unsigned long long)stats.lost,
+        (unsigned long long)stats.overruns,
+        (unsigned long long)stats.bad,
+        (unsigned long long)stats.junk);
+
+    close(fd);
+    if (capture.f != stdout)
+    {
+        fclose(capture.f);
+    }
+
+    return 0;
+}
+
+
+//---------------------------------------------------------------------------
+// Main function
+int main(
+    int argc,
+    char *argv[])
+{
+    Options opt;
+    TraceReader reader;
+    TraceExpander expander(reader);
+    WideReader wide(reader);
+    TraceExpander *pExpander;
+    TraceSource *pSource;
+    FILE *f;
+    int result = 0;
+
+    ParseArgs(argc, argv, opt);
+
+    if (!strcmp(opt.command, "capture"))
+    {
+        return CaptureStream(opt);
+    }
+
+    if (!reader.Open(opt.input))
+    {
+        perror(opt.input);
+        return 1;
+    }
+
+    if (opt.filtered)
+    {
+        FilteredReader filtered(reader);
+
+        // The cycles that weren't stored are unknown, so the filtered
+        // format can't be converted or decoded
+        if (strcmp(opt.command, "dump") || opt.compressed)
+        {
+            Usage();
+        }
+
+        f = OpenOutput(opt.output, "w");
+        DumpFiltered(filtered, f);
+        if (f != stdout)
+        {
+            fclose(f);
+        }
+
+        return 0;
+    }
+
+    if ((opt.compressed || opt.signals) && opt.wide)
+    {
+        Usage();
+    }
+
+    pExpander = opt.compressed ? &expander : NULL;
+    pSource = opt.compressed ? static_cast<TraceSource *>(&expander) : &reader;
+    if (opt.wide)
+    {
+        pSource = &wide;
+    }
+
+    if (!strcmp(opt.command, "dump"))
+    {
+        f = OpenOutput(opt.output, "w");
+        Dump(*pSource, opt.signals, f);
+    }
+    else if (!strcmp(opt.command, "expand"))
+    {
+        f = OpenOutput(opt.output, "wb");
+        Expand(*pSource, f);
+    }
+    else if (!strcmp(opt.command, "decode"))
+    {
+        f = OpenOutput(opt.output, "w");
+        Decode(*pSource, opt.delay, f);
+    }
+    else if (!strcmp(opt.command, "disasm"))
+    {
+        f = OpenOutput(opt.output, "w");
+        Disasm(*pSource, opt.delay, f);
+    }
+    else if (!strcmp(opt.command, "profile"))
+    {
+        f = OpenOutput(opt.output, "w");
+        result = Profile(*pSource, opt, f);
+    }
+    else if (!strcmp(opt.command, "vcd"))
+    {
+        f = OpenOutput(opt.output, "w");
+        Vcd(*pSource, opt, f);
+    }
+    else if (!strcmp(opt.command, "latency") && opt.signals)
+    {
+        f = OpenOutput(opt.output, "w");
+        Latency(*pSource, opt, f);
+    }
+    else if (!strcmp(opt.command, "timing") && opt.wide)
+    {
+        f = OpenOutput(opt.output, "w");
+        Timing(wide, opt.budget, f);
+    }
+    else if (!strcmp(opt.command, "verify"))
+    {
+        f = OpenOutput(opt.output, "w");
+        result = Verify(*pSource, opt, f);
+    }
+    else
+    {
+        Usage();
+    }
+
+    if (pExpander && pExpander->PackedBeforeSync())
+    {
+        fprintf(stderr, "Skipped %llu packed longs before the first full long\n",
+            (unsigned long long)pExpander->PackedBeforeSync());
+    }
+
+    if (f != stdout)
+    {
+        fclose(f);
+    }
+
+    return result;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
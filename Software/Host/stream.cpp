@@ -0,0 +1,196 @@
+/*
+ * stream.cpp
+ *
+ * Receiving the trace stream of the PropeddleStream module
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "stream.h"
+#include <cstring>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+StreamParser::StreamParser(
+    Callback callback,
+    void *pContext)
+    : m_callback(callback)
+    , m_pContext(pContext)
+    , m_need(STREAM_HEADER_LEN)
+    , m_first(true)
+    , m_seq(0)
+    , m_lost(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+
+//---------------------------------------------------------------------------
+// Process received bytes
+void StreamParser::Feed(
+    const uint8_t *pData,
+    size_t len)
+{
+    while (len)
+    {
+        size_t have = m_frame.size();
+
+        if (have < 2)
+        {
+            // Looking for the sync bytes
+            uint8_t b = *pData++;
+            len--;
+
+            if (b == (have ? STREAM_SYNC2 : STREAM_SYNC1))
+            {
+                m_frame.push_back(b);
+            }
+            else
+            {
+                m_stats.junk += have + 1;
+                m_frame.clear();
+                if (b == STREAM_SYNC1)
+                {
+                    m_stats.junk--;
+                    m_frame.push_back(b);
+                }
+            }
+
+            continue;
+        }
+
+        // Copy as much of the frame as we have
+        size_t n = m_need - have;
+
+        if (n > len)
+        {
+            n = len;
+        }
+
+        m_frame.insert(m_frame.end(), pData, pData + n);
+        pData += n;
+        len -= n;
+
+        if (m_frame.size() == STREAM_HEADER_LEN)
+        {
+            // Header is complete; now we know the length
+            m_need = STREAM_HEADER_LEN + STREAM_TRAILER_LEN
+                + 4 * (m_frame[4] | (m_frame[5] << 8));
+        }
+        else if (m_frame.size() == m_need)
+        {
+            Frame();
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Process a complete frame
+void StreamParser::Frame()
+{
+    std::vector<uint8_t> frame;
+    const uint8_t *p = &m_frame[0];
+    size_t numLongs = (m_need - STREAM_HEADER_LEN - STREAM_TRAILER_LEN) / 4;
+    uint8_t sum = 0;
+
+    frame.swap(m_frame);
+    m_need = STREAM_HEADER_LEN;
+
+    for (size_t u = 2; u < frame.size() - 1; u++)
+    {
+        sum += p[u];
+    }
+
+    if (sum != p[frame.size() - 1])
+    {
+        // Bad frame, or we found a sync pattern in the middle of a frame.
+        // Look for a sync pattern again, after the start of this one.
+        m_stats.bad++;
+        m_stats.junk++;
+        Feed(p + 1, frame.size() - 1);
+        return;
+    }
+
+    uint16_t seq = p[2] | (p[3] << 8);
+
+    if (!m_first)
+    {
+        // Frames that were skipped by the stream cog are the same length
+        uint16_t skipped = seq - m_seq;
+
+        m_stats.lost += skipped;
+        m_lost += (uint64_t)skipped * numLongs;
+    }
+
+    m_first = false;
+    m_seq = seq + 1;
+
+    if (p[frame.size() - 2])
+    {
+        // The trace cog overwrote the data while it was being sent
+        m_stats.overruns++;
+        m_lost += numLongs;
+        return;
+    }
+
+    // The longs are little-endian
+    std::vector<uint32_t> longs(numLongs);
+
+    p += STREAM_HEADER_LEN;
+    for (size_t u = 0; u < numLongs; u++, p += 4)
+    {
+        longs[u] = (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+            | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    m_stats.frames++;
+    m_stats.longs += numLongs;
+
+    m_callback(m_pContext, longs.empty() ? NULL : &longs[0], numLongs, m_lost);
+    m_lost = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,128 @@
+/*
+ * stream.h
+ *
+ * Receiving the trace stream of the PropeddleStream module
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef STREAM_H
+#define STREAM_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Frame format. See PropeddleStream.spin.
+#define STREAM_SYNC1        (0xA5)
+#define STREAM_SYNC2        (0x5A)
+#define STREAM_HEADER_LEN   (6)         // Sync, sequence number, length
+#define STREAM_TRAILER_LEN  (2)         // Status, checksum
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Statistics of a stream
+struct StreamStats
+{
+    uint64_t frames;                    // Good frames
+    uint64_t longs;                     // Longs in good frames
+    uint64_t lost;                      // Frames missing from sequence
+    uint64_t overruns;                  // Frames with overrun status
+    uint64_t bad;                       // Frames with bad checksum
+    uint64_t junk;                      // Bytes skipped to find sync
+};
+
+
+//---------------------------------------------------------------------------
+// Frame parser
+//
+// Bytes from the serial port are fed to the parser in blocks of any size.
+// Whenever a complete frame is received, the callback is called with the
+// longs in the frame. Frames with a bad checksum or an overrun status are
+// dropped and counted as such.
+class StreamParser
+{
+public:
+    typedef void (*Callback)(
+        void *pContext,                 // Context given to constructor
+        const uint32_t *pLongs,         // Longs in the normal trace format
+        size_t numLongs,                // Number of longs
+        uint64_t lostBefore);           // Longs lost before this frame
+
+    StreamParser(
+        Callback callback,              // Called for each good frame
+        void *pContext);                // Context passed to callback
+
+    void Feed(
+        const uint8_t *pData,           // Received bytes
+        size_t len);                    // Number of received bytes
+
+    const StreamStats &Stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    void Frame();
+
+    Callback              m_callback;
+    void                 *m_pContext;
+    std::vector<uint8_t>  m_frame;      // Frame being received
+    size_t                m_need;       // Total length of current frame
+    bool                  m_first;      // No frame received yet
+    uint16_t              m_seq;        // Expected sequence number
+    uint64_t              m_lost;       // Longs lost since last good frame
+    StreamStats           m_stats;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
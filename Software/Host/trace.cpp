@@ -0,0 +1,312 @@
+/*
+ * trace.cpp
+ *
+ * Reading trace dumps of the PropeddleTrace module on the host
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "trace.h"
+#include <cstring>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Number of longs to read from the file at a time
+#define READ_BLOCK (1u << 16)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+TraceReader::TraceReader()
+    : m_file(NULL)
+    , m_buf(READ_BLOCK)
+    , m_pos(0)
+    , m_len(0)
+    , m_zeroes(0)
+{
+}
+
+
+//---------------------------------------------------------------------------
+// Destructor
+TraceReader::~TraceReader()
+{
+    if (m_file && (m_file != stdin))
+    {
+        fclose(m_file);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Open a file
+bool TraceReader::Open(
+    const char *filename)
+{
+    if (!strcmp(filename, "-"))
+    {
+        m_file = stdin;
+    }
+    else
+    {
+        m_file = fopen(filename, "rb");
+    }
+
+    return m_file != NULL;
+}
+
+
+//---------------------------------------------------------------------------
+// Read the next block from the file
+bool TraceReader::Fill()
+{
+    uint8_t *p = reinterpret_cast<uint8_t *>(&m_buf[0]);
+
+    m_pos = 0;
+    m_len = fread(p, sizeof(uint32_t), m_buf.size(), m_file);
+
+    // The Propeller is little-endian. Convert the longs in place so this
+    // works on any host.
+    for (size_t u = 0; u < m_len; u++, p += 4)
+    {
+        m_buf[u] = (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+            | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    return m_len != 0;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the next long
+//
+// Zero longs are counted instead of returned until a non-zero long comes
+// along, so that the zero longs at the end of the file can be dropped.
+bool TraceReader::Next(
+    uint32_t &raw)
+{
+    if (m_zeroes)
+    {
+        // There's a non-zero long after these
+        m_zeroes--;
+        raw = 0;
+        return true;
+    }
+
+    for (;;)
+    {
+        if ((m_pos == m_len) && !Fill())
+        {
+            // Drop the zero longs at the end of the file
+            m_zeroes = 0;
+            return false;
+        }
+
+        raw = m_buf[m_pos++];
+        if (raw)
+        {
+            break;
+        }
+
+        m_zeroes++;
+    }
+
+    if (m_zeroes)
+    {
+        // Return the first zero long and keep the non-zero long for later
+        m_pos--;
+        m_zeroes--;
+        raw = 0;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Constructor
+TraceExpander::TraceExpander(
+    TraceReader &reader)
+    : m_reader(reader)
+    , m_packed(0)
+    , m_count(0)
+    , m_addr(0)
+    , m_synced(false)
+    , m_unsynced(0)
+{
+}
+
+
+//---------------------------------------------------------------------------
+// Get the next cycle
+bool TraceExpander::Next(
+    uint32_t &raw)
+{
+    while (!m_count)
+    {
+        uint32_t u;
+
+        if (!m_reader.Next(u))
+        {
+            return false;
+        }
+
+        if (!(u & TRACE_MASK_PACKED))
+        {
+            // Full long: this is already in the normal format
+            m_addr = (u & TRACE_MASK_ADDR) >> TRACE_SHIFT_ADDR;
+            m_synced = true;
+            raw = u;
+            return true;
+        }
+
+        if (!m_synced)
+        {
+            // The address is unknown until the first full long, which
+            // can only happen if the start of the trace is missing.
+            m_unsynced++;
+            continue;
+        }
+
+        m_packed = u;
+        m_count = (u & TRACE_MASK_COUNT) >> TRACE_SHIFT_COUNT;
+    }
+
+    // Each byte in a packed long is a read from the next address
+    m_addr = (m_addr + 1) & 0xFFFF;
+    raw = TRACE_MASK_RW | (m_addr << TRACE_SHIFT_ADDR) | (m_packed & TRACE_MASK_DATA);
+    m_packed >>= 8;
+    m_count--;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Constructor
+FilteredReader::FilteredReader(
+    TraceReader &reader)
+    : m_reader(reader)
+    , m_cycle(0)
+{
+}
+
+
+//---------------------------------------------------------------------------
+// Get the next stored cycle
+bool FilteredReader::Next(
+    uint64_t &cycle,
+    uint32_t &raw)
+{
+    uint32_t u;
+
+    for (;;)
+    {
+        if (!m_reader.Next(u))
+        {
+            return false;
+        }
+
+        if (!(u & TRACE_MASK_GAP))
+        {
+            break;
+        }
+
+        m_cycle += u & TRACE_MASK_GAPLEN;
+    }
+
+    m_cycle += (u & TRACE_MASK_SKIP) >> TRACE_SHIFT_SKIP;
+    cycle = m_cycle++;
+
+    // The skip count is where the control bits are in the normal format
+    raw = u & (TRACE_MASK_RW | TRACE_MASK_ADDR | TRACE_MASK_DATA);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Constructor
+WideReader::WideReader(
+    TraceReader &reader)
+    : m_reader(reader)
+    , m_clock(0)
+    , m_clocks(0)
+    , m_pending(false)
+{
+}
+
+
+//---------------------------------------------------------------------------
+// Get the next cycle
+bool WideReader::Next(
+    uint32_t &raw)
+{
+    uint32_t clock;
+
+    if (!m_pending && !m_reader.Next(m_clock))
+    {
+        return false;
+    }
+
+    clock = m_clock;
+    m_pending = false;
+
+    if (!m_reader.Next(raw))
+    {
+        return false;
+    }
+
+    // Read ahead to the counter value of the next cycle
+    m_pending = m_reader.Next(m_clock);
+    m_clocks = m_pending ? m_clock - clock : 0;
+
+    return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,242 @@
+/*
+ * trace.h
+ *
+ * Reading trace dumps of the PropeddleTrace module on the host
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Fields of a trace long in the normal format. See PropeddleTrace.spin.
+#define TRACE_MASK_RW       (0x80000000u)   // 1=read, 0=write
+#define TRACE_MASK_CTRL     (0xFF000000u)   // Pins 16-23
+#define TRACE_MASK_ADDR     (0x00FFFF00u)
+#define TRACE_MASK_DATA     (0x000000FFu)
+#define TRACE_SHIFT_ADDR    (8)
+
+// Fields of a packed long in the compressed format
+#define TRACE_MASK_PACKED   (0x40000000u)   // 1=packed long, 0=full long
+#define TRACE_MASK_COUNT    (0x03000000u)   // Number of bytes in packed long
+#define TRACE_SHIFT_COUNT   (24)
+
+// Fields of the filtered format
+#define TRACE_MASK_GAP      (0x40000000u)   // 1=gap long, 0=cycle long
+#define TRACE_MASK_SKIP     (0x3F000000u)   // Cycles skipped before cycle
+#define TRACE_SHIFT_SKIP    (24)
+#define TRACE_MASK_GAPLEN   (0x3FFFFFFFu)   // Cycles skipped in gap long
+
+// Signals in the signals format, in place of control bits 16-22. A bit is 1
+// when the signal is active.
+#define TRACE_MASK_SIGNALS  (0x7F000000u)
+#define TRACE_SIG_RES       (0x01000000u)   // Reset
+#define TRACE_SIG_NRDY      (0x02000000u)   // Not ready (6502 held)
+#define TRACE_SIG_SO        (0x04000000u)   // Set overflow
+#define TRACE_SIG_IRQ       (0x08000000u)   // Interrupt request
+#define TRACE_SIG_NBE       (0x10000000u)   // Not bus enable
+#define TRACE_SIG_NMI       (0x20000000u)   // Non-maskable interrupt
+#define TRACE_SIG_SETUP     (0x40000000u)   // Expansion I/O setup
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Trace long in the normal format
+struct TraceRecord
+{
+    uint32_t raw;
+
+    bool     IsRead() const  { return (raw & TRACE_MASK_RW) != 0; }
+    unsigned Addr() const    { return (raw & TRACE_MASK_ADDR) >> TRACE_SHIFT_ADDR; }
+    unsigned Data() const    { return raw & TRACE_MASK_DATA; }
+    unsigned Ctrl() const    { return raw >> 24; }
+};
+
+
+//---------------------------------------------------------------------------
+// Source of trace longs
+class TraceSource
+{
+public:
+    virtual ~TraceSource() {}
+
+    virtual bool                        // Returns false at end of trace
+    Next(
+        uint32_t &raw) = 0;             // Returns next long
+};
+
+
+//---------------------------------------------------------------------------
+// Reader for binary trace dumps
+//
+// A dump is a copy of the hub buffer of the trace cog: a sequence of longs
+// in little-endian order. The buffer is cleared before the trace cog
+// starts, so zero longs at the end of the file are unused entries; they are
+// skipped. Zero longs in the middle of the file are returned as usual.
+//
+// The file is read in large blocks, so it can be much larger than memory.
+class TraceReader : public TraceSource
+{
+public:
+    TraceReader();
+    ~TraceReader();
+
+    bool                                // Returns false if file can't open
+    Open(
+        const char *filename);          // File name, "-" for stdin
+
+    bool                                // Returns false at end of file
+    Next(
+        uint32_t &raw);                 // Returns next long
+
+private:
+    bool Fill();
+
+    FILE                 *m_file;
+    std::vector<uint32_t> m_buf;
+    size_t                m_pos;
+    size_t                m_len;
+    uint64_t              m_zeroes;     // Pending zero longs
+};
+
+
+//---------------------------------------------------------------------------
+// Expander for the compressed format
+//
+// Returns each cycle of a compressed trace as a long in the normal format.
+// The control bits other than R/W are 0, because the compressed format
+// doesn't store them.
+class TraceExpander : public TraceSource
+{
+public:
+    TraceExpander(
+        TraceReader &reader);           // Reader for compressed longs
+
+    bool                                // Returns false at end of trace
+    Next(
+        uint32_t &raw);                 // Returns next long, normal format
+
+    uint64_t                            // Returns num of packed longs
+    PackedBeforeSync() const            //  before first full long
+    {
+        return m_unsynced;
+    }
+
+private:
+    TraceReader &m_reader;
+    uint32_t     m_packed;              // Current packed long
+    unsigned     m_count;               // Bytes left in current packed long
+    unsigned     m_addr;                // Address of previous cycle
+    bool         m_synced;              // True after the first full long
+    uint64_t     m_unsynced;            // Packed longs skipped before sync
+};
+
+
+//---------------------------------------------------------------------------
+// Reader for the filtered format
+//
+// Returns the stored cycles with their cycle numbers, counted from the
+// start of the trace.
+class FilteredReader
+{
+public:
+    FilteredReader(
+        TraceReader &reader);           // Reader for filtered longs
+
+    bool                                // Returns false at end of trace
+    Next(
+        uint64_t &cycle,                // Returns cycle number
+        uint32_t &raw);                 // Returns cycle, normal format
+
+private:
+    TraceReader &m_reader;
+    uint64_t     m_cycle;               // Number of next cycle
+};
+
+
+//---------------------------------------------------------------------------
+// Reader for the wide format
+//
+// Returns the trace long of each cycle, and the number of Propeller clocks
+// that the cycle took: the difference between its counter value and the
+// counter value of the next cycle. The number of clocks is 0 for the last
+// cycle, because there is no next cycle. If the trace ends with a counter
+// value without a trace long, the cycle was never finished, so it isn't
+// returned; but its counter value is used for the cycle before it.
+class WideReader : public TraceSource
+{
+public:
+    WideReader(
+        TraceReader &reader);           // Reader for wide longs
+
+    bool                                // Returns false at end of trace
+    Next(
+        uint32_t &raw);                 // Returns next long, normal format
+
+    uint32_t                            // Returns num of Propeller clocks
+    Clocks() const                      //  of the cycle that Next returned
+    {
+        return m_clocks;
+    }
+
+private:
+    TraceReader &m_reader;
+    uint32_t     m_clock;               // Counter value of next cycle
+    uint32_t     m_clocks;              // Clocks of current cycle
+    bool         m_pending;             // m_clock was read already
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * vcd.cpp
+ *
+ * Writing 65C02 bus cycles as a Value Change Dump for waveform viewers
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "vcd.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Identifiers of the variables in the file
+#define VCD_ID_PHI2     '!'
+#define VCD_ID_ADDR     '"'
+#define VCD_ID_DATA     '#'
+#define VCD_ID_RW       '$'
+#define VCD_ID_SYNC     '%'
+#define VCD_ID_SIGNALS  '&'             // First of the signals
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DATA
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Signals in the order of their identifiers
+static const struct
+{
+    uint32_t    mask;
+    const char *name;
+}   s_signals[] =
+{
+    { TRACE_SIG_RES,   "res"   },
+    { TRACE_SIG_NRDY,  "nrdy"  },
+    { TRACE_SIG_SO,    "so"    },
+    { TRACE_SIG_IRQ,   "irq"   },
+    { TRACE_SIG_NBE,   "nbe"   },
+    { TRACE_SIG_NMI,   "nmi"   },
+    { TRACE_SIG_SETUP, "setup" },
+};
+
+#define VCD_NUM_SIGNALS (sizeof(s_signals) / sizeof(s_signals[0]))
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+VcdWriter::VcdWriter(
+    FILE *f,
+    bool signals,
+    unsigned period)
+    : m_f(f)
+    , m_signals(signals)
+    , m_period(period < 2 ? 2 : period)
+    , m_time(0)
+    , m_first(true)
+    , m_addr(0)
+    , m_data(0)
+    , m_read(false)
+    , m_sync(VCD_SYNC_LOW)
+    , m_sigs(0)
+{
+    Header();
+}
+
+
+//---------------------------------------------------------------------------
+// Write the definitions
+void VcdWriter::Header()
+{
+    fprintf(m_f,
+        "$version proptrace $end\n"
+        "$timescale 1ns $end\n"
+        "$scope module propeddle $end\n"
+        "$var wire 1 %c phi2 $end\n"
+        "$var wire 16 %c addr [15:0] $end\n"
+        "$var wire 8 %c data [7:0] $end\n"
+        "$var wire 1 %c rw $end\n"
+        "$var wire 1 %c sync $end\n",
+        VCD_ID_PHI2, VCD_ID_ADDR, VCD_ID_DATA, VCD_ID_RW, VCD_ID_SYNC);
+
+    if (m_signals)
+    {
+        for (unsigned u = 0; u < VCD_NUM_SIGNALS; u++)
+        {
+            fprintf(m_f, "$var wire 1 %c %s $end\n",
+                VCD_ID_SIGNALS + u, s_signals[u].name);
+        }
+    }
+
+    fprintf(m_f,
+        "$upscope $end\n"
+        "$enddefinitions $end\n");
+}
+
+
+//---------------------------------------------------------------------------
+// Append a time stamp to a text buffer
+static char *Time(
+    char *p,
+    uint64_t time)
+{
+    char digits[24];
+    unsigned n = 0;
+
+    do
+    {
+        digits[n++] = (char)('0' + time % 10);
+        time /= 10;
+    } while (time);
+
+    *p++ = '#';
+    while (n)
+    {
+        *p++ = digits[--n];
+    }
+
+    *p++ = '\n';
+
+    return p;
+}
+
+
+//---------------------------------------------------------------------------
+// Append a scalar value to a text buffer
+static inline char *Scalar(
+    char *p,
+    char value,
+    char id)
+{
+    *p++ = value;
+    *p++ = id;
+    *p++ = '\n';
+
+    return p;
+}
+
+
+//---------------------------------------------------------------------------
+// Append a vector value to a text buffer
+static char *Bits(
+    char *p,
+    unsigned value,
+    unsigned numBits,
+    char id)
+{
+    *p++ = 'b';
+    for (unsigned u = numBits; u; u--)
+    {
+        *p++ = (char)('0' + ((value >> (u - 1)) & 1));
+    }
+
+    *p++ = ' ';
+    *p++ = id;
+    *p++ = '\n';
+
+    return p;
+}
+
+
+//---------------------------------------------------------------------------
+// Write a cycle
+void VcdWriter::Cycle(
+    const TraceRecord &r,
+    VcdSync sync)
+{
+    char text[256];
+    char *p = text;
+
+    // Start of the cycle: Phi1
+    p = Time(p, m_time);
+    p = Scalar(p, '0', VCD_ID_PHI2);
+
+    if (m_first || (r.Addr() != m_addr))
+    {
+        m_addr = r.Addr();
+        p = Bits(p, m_addr, 16, VCD_ID_ADDR);
+    }
+
+    if (m_first || (r.IsRead() != m_read))
+    {
+        m_read = r.IsRead();
+        p = Scalar(p, m_read ? '1' : '0', VCD_ID_RW);
+    }
+
+    if (m_first || (sync != m_sync))
+    {
+        m_sync = sync;
+        p = Scalar(p, "01x"[sync], VCD_ID_SYNC);
+    }
+
+    // Phi2: the data bus is valid, and the signals were latched
+    p = Time(p, m_time + m_period / 2);
+    p = Scalar(p, '1', VCD_ID_PHI2);
+
+    if (m_first || (r.Data() != m_data))
+    {
+        m_data = r.Data();
+        p = Bits(p, m_data, 8, VCD_ID_DATA);
+    }
+
+    if (m_signals)
+    {
+        uint32_t sigs = r.raw & TRACE_MASK_SIGNALS;
+
+        for (unsigned u = 0; u < VCD_NUM_SIGNALS; u++)
+        {
+            if (m_first || ((sigs ^ m_sigs) & s_signals[u].mask))
+            {
+                p = Scalar(p, (sigs & s_signals[u].mask) ? '1' : '0',
+                    (char)(VCD_ID_SIGNALS + u));
+            }
+        }
+
+        m_sigs = sigs;
+    }
+
+    fwrite(text, 1, (size_t)(p - text), m_f);
+
+    m_first = false;
+    m_time += m_period;
+}
+
+
+//---------------------------------------------------------------------------
+// Write the end of the last cycle, so viewers show it completely
+void VcdWriter::Finish()
+{
+    if (!m_first)
+    {
+        fprintf(m_f, "#%llu\n0%c\n", (unsigned long long)m_time, VCD_ID_PHI2);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,111 @@
+/*
+ * vcd.h
+ *
+ * Writing 65C02 bus cycles as a Value Change Dump for waveform viewers
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef VCD_H
+#define VCD_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "trace.h"
+#include <cstdint>
+#include <cstdio>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Values of the SYNC output of the 65C02, which isn't in the trace
+enum VcdSync
+{
+    VCD_SYNC_LOW,
+    VCD_SYNC_HIGH,                      // Opcode fetch
+    VCD_SYNC_UNKNOWN,                   // Cycle couldn't be decoded
+};
+
+
+//---------------------------------------------------------------------------
+// VCD writer
+//
+// Each cycle starts with Phi2 low and the address and R/W from the trace
+// long; the data bus (and the signals, which are latched just before)
+// change when Phi2 goes high halfway through the cycle. Only the values
+// that change are written, and each cycle is written as it comes in, so
+// nothing needs to be kept in memory.
+//
+// The times are in nanoseconds, with a fixed cycle time: the trace doesn't
+// say how long each cycle took.
+class VcdWriter
+{
+public:
+    VcdWriter(
+        FILE *f,                        // Output file
+        bool signals,                   // Include signals (signals format)
+        unsigned period);               // Cycle time in ns
+
+    void Cycle(
+        const TraceRecord &r,           // Cycle
+        VcdSync sync);                  // Derived SYNC
+
+    void Finish();                      // Write the end of the last cycle
+
+private:
+    void Header();
+
+    FILE     *m_f;
+    bool      m_signals;
+    unsigned  m_period;
+    uint64_t  m_time;                   // Start of the next cycle
+    bool      m_first;                  // No values written yet
+    unsigned  m_addr;
+    unsigned  m_data;
+    bool      m_read;
+    VcdSync   m_sync;
+    uint32_t  m_sigs;                   // TRACE_SIG bits
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
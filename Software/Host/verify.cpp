@@ -0,0 +1,744 @@
+/*
+ * verify.cpp
+ *
+ * Verifying a trace against a model of the 65C02
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "verify.h"
+#include "disasm.h"
+#include <cstring>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Flags of each memory location
+#define VERIFY_MEM_KNOWN    (0x01)      // Contents are known
+#define VERIFY_MEM_EXCLUDED (0x02)      // Reads aren't checked
+
+// Number of cycles after a divergence where a reset can start, and the
+// number of cycles shown after the divergence in the report
+#define VERIFY_RESET_SEARCH (16)
+#define VERIFY_CONTEXT      (4)
+
+// Interrupt vectors
+#define VECTOR_NMI          (0xFFFA)
+#define VECTOR_RESET        (0xFFFC)
+#define VECTOR_IRQ          (0xFFFE)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CODE
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Constructor
+Verifier::Verifier(
+    TraceWindow &window,
+    bool signals)
+    : m_window(window)
+    , m_decoder(window)
+    , m_signals(signals)
+    , m_memory(65536)
+    , m_flags(65536)
+    , m_cycle(0)
+    , m_start(0)
+    , m_accesses(0)
+    , m_interrupt(false)
+    , m_haveHint(false)
+    , m_seeded(false)
+    , m_end(false)
+    , m_havePrev(false)
+    , m_diverged(false)
+    , m_badCycle(0)
+    , m_expAccess(CPU_READ)
+    , m_expAddr(0)
+    , m_expMask(0)
+    , m_reason("")
+    , m_firstCycle(0)
+    , m_fromReset(false)
+    , m_instructions(0)
+    , m_interrupts(0)
+    , m_resets(0)
+    , m_stalls(0)
+    , m_stops(0)
+{
+    memset(&m_hint, 0, sizeof(m_hint));
+    m_actual.raw = 0;
+    m_expData.value = 0;
+    m_expData.known = false;
+}
+
+
+//---------------------------------------------------------------------------
+// Load a memory image, e.g. of the ROM
+bool Verifier::LoadImage(
+    const char *filename,
+    uint16_t addr)
+{
+    FILE *f = fopen(filename, "rb");
+
+    if (!f)
+    {
+        return false;
+    }
+
+    size_t n = fread(&m_memory[addr], 1, 65536 - (size_t)addr, f);
+
+    for (size_t u = addr; u < addr + n; u++)
+    {
+        m_flags[u] |= VERIFY_MEM_KNOWN;
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Exclude a range from the check of read data
+void Verifier::Exclude(
+    uint16_t first,
+    uint16_t last)
+{
+    for (unsigned u = first; u <= last; u++)
+    {
+        m_flags[u] = VERIFY_MEM_EXCLUDED;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Record a divergence
+bool                                    // Always returns false
+Verifier::Diverge(
+    const TraceRecord &r,
+    CpuAccess access,
+    uint16_t addr,
+    uint16_t mask,
+    CpuValue data,
+    const char *reason)
+{
+    m_diverged = true;
+    m_badCycle = m_cycle;
+    m_actual = r;
+    m_expAccess = access;
+    m_expAddr = addr;
+    m_expMask = mask;
+    m_expData = data;
+    m_reason = reason;
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+// Check a bus cycle of the model against the trace
+bool Verifier::Access(
+    CpuAccess access,
+    uint16_t &addr,
+    uint16_t mask,
+    CpuValue &data)
+{
+    bool read = (access != CPU_WRITE);
+    TraceRecord r;
+
+    for (;;)
+    {
+        if (!m_window.Get(m_cycle, r))
+        {
+            m_end = true;
+            return false;
+        }
+
+        if (m_signals && Stall(r))
+        {
+            // The 65C02 repeats the cycle when RDY goes high again
+            m_stalls++;
+            m_cycle++;
+            continue;
+        }
+
+        if ((r.IsRead() == read) && !((r.Addr() ^ addr) & mask))
+        {
+            break;
+        }
+
+        if (!m_signals && Stall(r))
+        {
+            m_stalls++;
+            m_cycle++;
+            continue;
+        }
+
+        return Diverge(r, access, addr, mask, data,
+            (r.IsRead() != read) ? "R/W" : "address");
+    }
+
+    addr = (uint16_t)r.Addr();
+    uint8_t &flags = m_flags[addr];
+
+    if (access == CPU_WRITE)
+    {
+        if (data.known && (data.value != r.Data()))
+        {
+            return Diverge(r, access, addr, mask, data, "write data");
+        }
+
+        if (!(flags & VERIFY_MEM_EXCLUDED))
+        {
+            m_memory[addr] = (uint8_t)r.Data();
+            flags |= VERIFY_MEM_KNOWN;
+        }
+    }
+    else if ((access == CPU_READ) && !(flags & VERIFY_MEM_EXCLUDED))
+    {
+        // Dummy reads aren't used, because their addresses aren't checked
+        if ((flags & VERIFY_MEM_KNOWN) && (m_memory[addr] != r.Data()))
+        {
+            CpuValue expected = { m_memory[addr], true };
+
+            return Diverge(r, access, addr, mask, expected, "read data");
+        }
+
+        m_memory[addr] = (uint8_t)r.Data();
+        flags |= VERIFY_MEM_KNOWN;
+    }
+
+    data.value = (uint8_t)r.Data();
+    data.known = true;
+    m_prev = r;
+    m_havePrev = true;
+    m_accesses++;
+    m_cycle++;
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the number of cycles left in the current instruction
+//
+// The decoder found where the next instruction starts. With signals, the
+// cycles where RDY was low don't count.
+bool Verifier::Remaining(
+    unsigned &cycles)
+{
+    if (!m_haveHint || (m_hint.cycle != m_start) || !m_hint.complete
+        || (m_hint.kind != INSTR_NORMAL))
+    {
+        return false;
+    }
+
+    uint64_t end = m_hint.cycle + m_hint.numCycles;
+
+    cycles = 0;
+    for (uint64_t c = m_cycle; c < end; c++)
+    {
+        TraceRecord r;
+
+        if (!m_window.Get(c, r))
+        {
+            return false;
+        }
+
+        if (!m_signals || !(r.raw & TRACE_SIG_NRDY))
+        {
+            cycles++;
+        }
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Get the address of a cycle ahead of the next one
+//
+// With signals, the cycles where RDY was low don't count.
+bool Verifier::Peek(
+    unsigned offset,
+    uint16_t &addr)
+{
+    TraceRecord r;
+
+    for (uint64_t c = m_cycle; m_window.Get(c, r); c++)
+    {
+        if (m_signals && (r.raw & TRACE_SIG_NRDY))
+        {
+            continue;
+        }
+
+        if (!offset--)
+        {
+            addr = (uint16_t)r.Addr();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+// Check if a cycle is a stall
+//
+// Without signals, a stall can only be recognized as a repeat of the cycle
+// before it.
+bool Verifier::Stall(
+    const TraceRecord &r) const
+{
+    if (m_signals)
+    {
+        return (r.raw & TRACE_SIG_NRDY) != 0;
+    }
+
+    return m_havePrev
+        && !((r.raw ^ m_prev.raw) & (TRACE_MASK_RW | TRACE_MASK_ADDR));
+}
+
+
+//---------------------------------------------------------------------------
+// Get the decoded instruction that includes the next cycle
+void Verifier::Hint()
+{
+    while (!m_haveHint || (m_hint.cycle + m_hint.numCycles <= m_cycle))
+    {
+        if (!m_decoder.Next(m_hint))
+        {
+            m_haveHint = false;
+            break;
+        }
+
+        m_haveHint = true;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Get the decoded instruction at the next cycle, skipping stalls
+//
+// The decoder counts the stalls before an instruction with the instruction
+// before it, so the model finishes an instruction before the decoded one
+// ends. The rest is skipped if it's all stalls.
+void Verifier::SkipStalls()
+{
+    for (;;)
+    {
+        Hint();
+
+        if (!m_haveHint || (m_hint.cycle == m_cycle))
+        {
+            break;
+        }
+
+        uint64_t end = m_hint.cycle + m_hint.numCycles;
+        uint64_t c;
+        TraceRecord r;
+
+        for (c = m_cycle; c < end; c++)
+        {
+            if (!m_window.Get(c, r) || !Stall(r))
+            {
+                break;
+            }
+        }
+
+        if (c < end)
+        {
+            break;
+        }
+
+        m_stalls += end - m_cycle;
+        m_cycle = end;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Start the model at a reset
+//
+// The stack pointer is known from the last of the three stack reads before
+// the vector.
+bool Verifier::Reset(
+    uint64_t vector)
+{
+    TraceRecord lo;
+    TraceRecord hi;
+    TraceRecord r;
+    CpuValue s = { 0, false };
+
+    if (!m_window.Get(vector, lo) || !m_window.Get(vector + 1, hi))
+    {
+        return false;
+    }
+
+    if ((vector > 0) && m_window.Get(vector - 1, r) && r.IsRead()
+        && ((r.Addr() & 0xFF00) == 0x0100))
+    {
+        s.value = (uint8_t)(r.Addr() - 1);
+        s.known = true;
+    }
+
+    m_cpu.Reset((uint16_t)(lo.Data() | (hi.Data() << 8)), s);
+    m_cycle = vector + 2;
+    m_havePrev = false;
+    m_diverged = false;
+
+    if (!m_seeded)
+    {
+        m_seeded = true;
+        m_fromReset = true;
+        m_firstCycle = m_cycle;
+    }
+    else
+    {
+        m_resets++;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Check if an interrupt sequence starts at the next cycle
+//
+// This is for when the decoder lost track, e.g. because of a stall in the
+// middle of an instruction. The interrupt sequence is easy to recognize:
+// two reads of the same address, three stack writes and the vector reads.
+// A BRK reads the byte after the opcode in its second cycle instead.
+uint16_t                                // Returns vector address, 0 if none
+Verifier::FindInterrupt()
+{
+    TraceRecord r[7];
+    unsigned n = 0;
+
+    for (uint64_t c = m_cycle; n < 7; c++)
+    {
+        if (!m_window.Get(c, r[n]))
+        {
+            return 0;
+        }
+
+        if (!m_signals || !Stall(r[n]))
+        {
+            n++;
+        }
+    }
+
+    for (unsigned u = 0; u < 7; u++)
+    {
+        if (r[u].IsRead() != ((u < 2) || (u > 4)))
+        {
+            return 0;
+        }
+    }
+
+    unsigned vector = r[5].Addr();
+
+    if ((r[1].Addr() != r[0].Addr())
+        || ((r[2].Addr() & 0xFF00) != 0x0100)
+        || ((vector != VECTOR_NMI) && (vector != VECTOR_IRQ))
+        || (r[6].Addr() != vector + 1))
+    {
+        return 0;
+    }
+
+    return (uint16_t)vector;
+}
+
+
+//---------------------------------------------------------------------------
+// Look for a reset that explains a divergence
+bool Verifier::FindReset()
+{
+    for (uint64_t c = m_start; c < m_badCycle + VERIFY_RESET_SEARCH; c++)
+    {
+        TraceRecord r;
+        TraceRecord r1;
+
+        if (!m_window.Get(c, r) || !m_window.Get(c + 1, r1))
+        {
+            break;
+        }
+
+        if (r.IsRead() && (r.Addr() == VECTOR_RESET)
+            && r1.IsRead() && (r1.Addr() == VECTOR_RESET + 1))
+        {
+            return Reset(c);
+        }
+    }
+
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+// Format a cycle in the same way as the dump command
+char *Verifier::FormatCycle(
+    char *p,
+    uint64_t cycle,
+    const TraceRecord &r)
+{
+    return p + sprintf(p, "%08llX: %c %04X %02X",
+        (unsigned long long)cycle, r.IsRead() ? 'R' : 'W', r.Addr(), r.Data());
+}
+
+
+//---------------------------------------------------------------------------
+// Print the report of a divergence
+void Verifier::Report(
+    FILE *f)
+{
+    char expected[32];
+    char line[128];
+    char *p = expected;
+
+    // Unknown digits of the address are shown as question marks
+    *p++ = (m_expAccess == CPU_WRITE) ? 'W' : 'R';
+    *p++ = ' ';
+    for (unsigned u = 0; u < 4; u++)
+    {
+        unsigned shift = 12 - 4 * u;
+
+        *p++ = ((m_expMask >> shift) & 15)
+            ? "0123456789ABCDEF"[(m_expAddr >> shift) & 15] : '?';
+    }
+
+    if (m_expData.known
+        && ((m_expAccess == CPU_WRITE) || !strcmp(m_reason, "read data")))
+    {
+        p += sprintf(p, " %02X", m_expData.value);
+    }
+
+    *p = '\0';
+
+    fprintf(f, "Divergence in %s at cycle %08llX\n",
+        m_reason, (unsigned long long)m_badCycle);
+    FormatCycle(line, m_badCycle, m_actual);
+    fprintf(f, "  Expected: %s\n  Actual:   %s\n\n", expected, line + 10);
+
+    // The instruction as far as the model got
+    if (m_interrupt)
+    {
+        fprintf(f, "Instruction: interrupt sequence at $%04X\n", m_cpu.PC());
+    }
+    else if (!m_accesses)
+    {
+        fprintf(f, "Instruction: opcode fetch at $%04X\n", m_cpu.PC());
+    }
+    else
+    {
+        Disassemble(line, m_cpu.PC(), m_cpu.Bytes());
+        fprintf(f, "Instruction: %04X  %s\n", m_cpu.PC(), line);
+    }
+
+    m_before.Format(line);
+    fprintf(f, "Registers:   %s\n\n", line);
+
+    // The cycles of the instruction, and a few after it
+    for (uint64_t c = m_start; c <= m_badCycle + VERIFY_CONTEXT; c++)
+    {
+        TraceRecord r;
+
+        if (!m_window.Get(c, r))
+        {
+            break;
+        }
+
+        p = FormatCycle(line, c, r);
+        if (m_signals && (r.raw & TRACE_SIG_NRDY))
+        {
+            p += sprintf(p, "  (RDY low)");
+        }
+        else if (c == m_badCycle)
+        {
+            p += sprintf(p, "  <- expected %s", expected);
+        }
+
+        fprintf(f, "%s\n", line);
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Run the model in lockstep with the trace
+bool Verifier::Run(
+    FILE *f)
+{
+    while (!m_end)
+    {
+        SkipStalls();
+
+        bool here = m_haveHint && (m_hint.cycle == m_cycle);
+
+        if (!m_seeded || (here && (m_hint.kind == INSTR_RESET)))
+        {
+            if (!m_haveHint)
+            {
+                break;
+            }
+
+            if (m_hint.kind == INSTR_RESET)
+            {
+                // The decoded reset ends with the vector
+                if (!Reset(m_hint.cycle + m_hint.numCycles - 2))
+                {
+                    break;
+                }
+
+                continue;
+            }
+
+            if (!here || (m_hint.kind != INSTR_NORMAL))
+            {
+                m_cycle = m_hint.cycle + m_hint.numCycles;
+                continue;
+            }
+
+            m_cpu.Unknown(m_hint.pc);
+            m_seeded = true;
+            m_firstCycle = m_cycle;
+        }
+
+        bool ok;
+
+        m_before = m_cpu;
+        m_start = m_cycle;
+        m_accesses = 0;
+
+        uint16_t vector = 0;
+
+        if (here)
+        {
+            if (m_hint.kind == INSTR_IRQ)
+            {
+                vector = VECTOR_IRQ;
+            }
+            else if (m_hint.kind == INSTR_NMI)
+            {
+                vector = VECTOR_NMI;
+            }
+        }
+        else
+        {
+            vector = FindInterrupt();
+        }
+
+        m_interrupt = (vector != 0);
+
+        if (m_interrupt)
+        {
+            ok = m_cpu.Interrupt(*this, vector);
+            m_interrupts++;
+        }
+        else
+        {
+            ok = m_cpu.Step(*this);
+        }
+
+        if (!ok)
+        {
+            if (!m_diverged)
+            {
+                // The trace ends during the instruction
+                break;
+            }
+
+            if (FindReset())
+            {
+                continue;
+            }
+
+            Report(f);
+            return false;
+        }
+
+        m_instructions++;
+
+        if (m_cpu.Stopped())
+        {
+            // Only a reset starts the 65C02 again
+            m_stops++;
+            m_seeded = false;
+        }
+        else if (m_cpu.Waiting() && here)
+        {
+            // Skip the cycles where WAI waits for an interrupt
+            if (m_cycle < m_hint.cycle + m_hint.numCycles)
+            {
+                m_cycle = m_hint.cycle + m_hint.numCycles;
+            }
+        }
+    }
+
+    if (!m_instructions)
+    {
+        fprintf(f, "No instructions found to verify\n");
+        return true;
+    }
+
+    char regs[32];
+
+    m_cpu.Format(regs);
+    fprintf(f,
+        "No divergence in %llu instructions (cycles %08llX-%08llX)\n"
+        "Started at %s\n"
+        "%llu interrupts, %llu resets, %llu STP, %llu cycles skipped for RDY\n"
+        "Registers at the end: %s\n",
+        (unsigned long long)m_instructions,
+        (unsigned long long)m_firstCycle,
+        (unsigned long long)(m_cycle ? m_cycle - 1 : 0),
+        m_fromReset ? "a reset" : "an instruction, with unknown registers",
+        (unsigned long long)m_interrupts,
+        (unsigned long long)m_resets,
+        (unsigned long long)m_stops,
+        (unsigned long long)m_stalls,
+        regs);
+
+    return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,164 @@
+/*
+ * verify.h
+ *
+ * Verifying a trace against a model of the 65C02
+ *
+ * (C) Copyright 2011-2014 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "cpu.h"
+#include "decoder.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////////////////////////
+
+
+//---------------------------------------------------------------------------
+// Lockstep verifier
+//
+// The model runs in lockstep with the trace, and the verifier stops at the
+// first cycle where the R/W or the address on the bus isn't what the model
+// expects, where a write has other data than the model computed, or where
+// a read gets other data than what's known to be in memory. On real
+// hardware, this finds bus timing problems that corrupt a byte once in a
+// while, long before the program crashes.
+//
+// The model starts at the first reset in the trace, or with unknown
+// registers at the first instruction that the decoder finds. A reset later
+// in the trace (even in the middle of an instruction) starts it again.
+// The decoder also tells where the interrupt sequences are, because the
+// model can't predict them; where the decoder lost track, they're
+// recognized by their bus cycles.
+//
+// Memory is known from image files, and from reads and writes in the
+// trace. Ranges with I/O registers should be excluded, because their data
+// can change by itself.
+//
+// Dummy cycles are checked for R/W but not for the address, because the
+// addresses of dummy reads aren't documented and differ between 65C02s.
+//
+// With signals, cycles where RDY was low are skipped. Without signals, a
+// cycle that's the same as the one before it is skipped if the model
+// doesn't expect it.
+class Verifier : public CpuBus
+{
+public:
+    Verifier(
+        TraceWindow &window,            // Cycles to verify
+        bool signals);                  // Trace has signals (NRDY)
+
+    bool                                // Returns false if file can't open
+    LoadImage(
+        const char *filename,           // Binary file with memory contents
+        uint16_t addr);                 // Address of first byte
+
+    void Exclude(                       // Don't check reads in a range
+        uint16_t first,                 // First address, e.g. of I/O
+        uint16_t last);                 // Last address (inclusive)
+
+    bool                                // Returns false on divergence
+    Run(
+        FILE *f);                       // Output file for the report
+
+private:
+    bool Access(CpuAccess access, uint16_t &addr, uint16_t mask,
+        CpuValue &data);
+    bool Remaining(unsigned &cycles);
+    bool Peek(unsigned offset, uint16_t &addr);
+    bool Diverge(const TraceRecord &r, CpuAccess access, uint16_t addr,
+        uint16_t mask, CpuValue data, const char *reason);
+    bool Stall(const TraceRecord &r) const;
+    void Hint();
+    void SkipStalls();
+    bool Reset(uint64_t vector);
+    uint16_t FindInterrupt();
+    bool FindReset();
+    void Report(FILE *f);
+    char *FormatCycle(char *p, uint64_t cycle, const TraceRecord &r);
+
+    TraceWindow          &m_window;
+    Decoder               m_decoder;
+    bool                  m_signals;
+    Cpu65C02              m_cpu;
+    Cpu65C02              m_before;     // Model at start of instruction
+    std::vector<uint8_t>  m_memory;
+    std::vector<uint8_t>  m_flags;      // VERIFY_MEM bits
+    uint64_t              m_cycle;      // Next cycle
+    uint64_t              m_start;      // First cycle of instruction
+    unsigned              m_accesses;   // Cycles of instruction so far
+    bool                  m_interrupt;  // Instruction is an interrupt
+    Instruction           m_hint;       // Decoded instruction at m_cycle
+    bool                  m_haveHint;
+    bool                  m_seeded;     // Model is running
+    bool                  m_end;        // End of trace
+    TraceRecord           m_prev;       // Previous cycle
+    bool                  m_havePrev;
+
+    // Divergence
+    bool                  m_diverged;
+    uint64_t              m_badCycle;
+    TraceRecord           m_actual;     // Cycle in the trace
+    CpuAccess             m_expAccess;
+    uint16_t              m_expAddr;
+    uint16_t              m_expMask;
+    CpuValue              m_expData;
+    const char           *m_reason;
+
+    // Statistics
+    uint64_t              m_firstCycle; // Cycle where the model started
+    bool                  m_fromReset;  // Model started at a reset
+    uint64_t              m_instructions;
+    uint64_t              m_interrupts;
+    uint64_t              m_resets;
+    uint64_t              m_stalls;
+    uint64_t              m_stops;      // STP instructions
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
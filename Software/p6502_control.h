@@ -12,6 +12,14 @@
 #define P6502_CONTROL_H
 
 
+/////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "p6502_timing.h"
+
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -23,7 +31,7 @@ extern "C"
 /////////////////////////////////////////////////////////////////////////////
 
 
-#define P6502_CONTROL_DELAY_MIN (80)    // Minimum prop cycles per 6502 cycle
+#define P6502_CONTROL_DELAY_MIN (P6502_TIMING_DELAY_MIN) // Minimum prop cycles per 6502 cycle, see p6502_timing.h
 
 
 /////////////////////////////////////////////////////////////////////////////
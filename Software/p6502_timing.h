@@ -0,0 +1,175 @@
+/*
+ * p6502_timing.h
+ *
+ * Timing constants for the Propeddle system, calculated from the clock
+ * frequency of the Propeller and the datasheets of the chips on the board
+ *
+ * (C) Copyright 2011-2013 Jac Goudsmit
+ * Distributed under the MIT license. See bottom of the file for details.
+ */
+
+
+#ifndef P6502_TIMING_H
+#define P6502_TIMING_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MACROS
+/////////////////////////////////////////////////////////////////////////////
+
+
+// Clock frequency of the Propeller in Hz.
+// This must match the clkfreq setting in the board configuration file
+// (propeddle80.cfg or propeddle100.cfg). The preprocessor can't read the
+// configuration file, so pass the value on the command line, e.g.
+// -DP6502_CLKFREQ=100000000, if it's not the default.
+#ifndef P6502_CLKFREQ
+#define P6502_CLKFREQ (80000000)
+#endif
+
+
+//===========================================================================
+// Datasheet values
+//===========================================================================
+
+// All values are worst case values in nanoseconds at 3.3V. Change them if
+// you use different chips.
+
+// WDC 65C02S
+#define P6502_NS_6502_CYC   (125)       // Minimum cycle time (tCYC)
+#define P6502_NS_6502_PWL   (62)        // Minimum Phi1 time (tPWL)
+#define P6502_NS_6502_PWH   (62)        // Minimum Phi2 time (tPWH)
+#define P6502_NS_6502_ADS   (40)        // Address setup time (tADS)
+#define P6502_NS_6502_DSR   (15)        // Read data setup time (tDSR)
+#define P6502_NS_6502_PCS   (15)        // Processor control setup time (tPCS)
+
+// 74HC244 address buffers
+#define P6502_NS_244_EN     (45)        // Output enable time (tPZL, tPZH)
+
+// 74HC574 signal flip-flops
+#define P6502_NS_574_CQ     (45)        // Clock to output (tPHL, tPLH)
+
+// AS6C1008-55 RAM
+#define P6502_NS_RAM_AA     (55)        // Address access time (tAA)
+#define P6502_NS_RAM_OE     (30)        // Output enable to output (tOE)
+#define P6502_NS_RAM_WP     (45)        // Write pulse width (tWP)
+
+
+//===========================================================================
+// Fixed timing of the main loop
+//===========================================================================
+
+// These are the points in time (in Propeller clock cycles from the start of
+// Phi1) where the main loop does things. They are fixed by the instructions
+// in the loop, not by the cycle time, and other cogs depend on them, so they
+// can't be changed here. See the main loop for details.
+#define P6502_CLK_AEN       (8)         // Address buffers enabled
+#define P6502_CLK_ADDR      (16)        // Address read from INA
+#define P6502_CLK_SLC       (36)        // Signals clocked into the flip-flops
+#define P6502_CLK_PHI2      (40)        // Start of Phi2
+#define P6502_CLK_RAM       (62)        // RAM enabled (worst case)
+
+// Minimum cycle time that the main loop can handle because of the number
+// of instructions. It also has to be a multiple of 16, so that the hub
+// instruction in the loop always happens at the same point in time.
+#define P6502_CLK_LOOP      (80)
+
+
+//===========================================================================
+// Calculated values
+//===========================================================================
+
+// Convert nanoseconds to Propeller clock cycles, rounding up
+#define P6502_NS_TO_CLK(ns) \
+    (((ns) * (P6502_CLKFREQ / 1000000) + 999) / 1000)
+
+#define P6502_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// Minimum cycle time based on the datasheets. Each of the following has to
+// fit in the cycle:
+// - The cycle time of the 65C02
+// - Phi1 and the minimum Phi2 time of the 65C02
+// - Address setup time of the 65C02 plus access time of the RAM
+// - Clocking the signals, plus setup time of the 65C02 at the end of Phi2
+// - Enabling the RAM for reading, plus setup time of the 65C02
+// - Enabling the RAM for writing, for the minimum write pulse width
+#define P6502_CLK_DATASHEET \
+    P6502_MAX(P6502_MAX(P6502_MAX( \
+        P6502_NS_TO_CLK(P6502_NS_6502_CYC), \
+        P6502_CLK_PHI2 + P6502_NS_TO_CLK(P6502_NS_6502_PWH)), P6502_MAX( \
+        P6502_NS_TO_CLK(P6502_NS_6502_ADS + P6502_NS_RAM_AA), \
+        P6502_CLK_SLC + P6502_NS_TO_CLK(P6502_NS_574_CQ + P6502_NS_6502_PCS))), P6502_MAX( \
+        P6502_CLK_RAM + P6502_NS_TO_CLK(P6502_NS_RAM_OE + P6502_NS_6502_DSR), \
+        P6502_CLK_RAM + P6502_NS_TO_CLK(P6502_NS_RAM_WP)))
+
+// Minimum number of Propeller clock cycles per 6502 clock cycle
+// If the datasheets allow it, this is the minimum for the main loop.
+// Otherwise it's the datasheet minimum rounded up to a multiple of 16.
+#if P6502_CLK_DATASHEET <= P6502_CLK_LOOP
+#define P6502_TIMING_DELAY_MIN (P6502_CLK_LOOP)
+#else
+#define P6502_TIMING_DELAY_MIN ((P6502_CLK_DATASHEET + 15) & ~15)
+#endif
+
+// Minimum time for the first cycle, which may have to wait longer for the
+// hub.
+#define P6502_TIMING_DELAY_MIN_INIT (P6502_TIMING_DELAY_MIN + 15)
+
+// Number of NOPs to wait for the RAM in loops that enable the RAM and then
+// disable it two instructions later. The code was tested with one NOP so
+// that's the minimum.
+#define P6502_TIMING_RAM_NOPS \
+    P6502_MAX(1, (P6502_MAX( \
+        P6502_NS_TO_CLK(P6502_NS_RAM_WP), \
+        P6502_NS_TO_CLK(P6502_NS_RAM_OE + P6502_NS_6502_DSR)) - 8 + 3) / 4)
+
+
+//===========================================================================
+// Checks
+//===========================================================================
+
+// These can't be fixed by changing the cycle time
+#if P6502_NS_TO_CLK(P6502_NS_244_EN) > P6502_CLK_ADDR - P6502_CLK_AEN
+#error Propeller is too fast for the address buffers
+#endif
+
+#if P6502_NS_TO_CLK(P6502_NS_6502_PWL) > P6502_CLK_PHI2
+#error Propeller is too fast for the 65C02 Phi1 time
+#endif
+
+#if P6502_TIMING_DELAY_MIN > 511
+#error Minimum cycle time does not fit in an immediate value
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TERMS OF USE: MIT LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+
+/* Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/////////////////////////////////////////////////////////////////////////////
+// END
+/////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -32,9 +32,21 @@
 
 
 // Delay constants for main loop, in Propeller clock cycles.
-// Do not change.
-#define DELAY_MAINLOOP_MINDELAY_INIT (95) // Initial loop min duration
-#define DELAY_MAINLOOP_MINDELAY (80)  // Subsequent loops min duration
+// Do not change; these are calculated in p6502_timing.h from the clock
+// frequency and the datasheets.
+#define DELAY_MAINLOOP_MINDELAY_INIT (P6502_TIMING_DELAY_MIN_INIT) // Initial loop min duration
+#define DELAY_MAINLOOP_MINDELAY (P6502_TIMING_DELAY_MIN)  // Subsequent loops min duration
+
+// NOPs to wait for the RAM after enabling it
+#if P6502_TIMING_RAM_NOPS == 1
+#define RAM_NOPS "\n                 nop"
+#elif P6502_TIMING_RAM_NOPS == 2
+#define RAM_NOPS "\n                 nop" "\n                 nop"
+#elif P6502_TIMING_RAM_NOPS == 3
+#define RAM_NOPS "\n                 nop" "\n                 nop" "\n                 nop"
+#else
+#error Unsupported number of NOPs for the RAM
+#endif
 
 
 // Macro to turn anything into a string
@@ -47,28 +59,84 @@
 /////////////////////////////////////////////////////////////////////////////
 
 
+//---------------------------------------------------------------------------
+// Modes that patch the main loop
+//
+// Each line in this list registers one mode of the internal function. The
+// list is used to generate the mode numbers, and the entries in the mode
+// table (see InitModeTable in the assembler code below), so adding a mode
+// only takes a line here, plus the code for the mode itself.
+//
+// The parameters for each line are:
+// - Name of the mode (P6502_MODE_ is prepended)
+// - Value of the mode. This must be a literal number, because it's
+//   stringized into the assembler code (see Issue 60 at the top).
+// - Instruction to store at Phi1AltIns; executed at t=32 of each cycle
+// - Instruction to store at Phi2AltIns; executed at t=48 of each cycle
+// - Instruction to store at LoopIns at the end of the cycle
+// - Instruction to store at EndAltIns, executed when leaving the loop;
+//   this should normally jump to Restore.
+// - Label of the initialization code, which runs before the main loop
+//   starts, and should eventually jump to Run_Init.
+//
+// The Run mode doesn't patch the main loop, so it's not in the list.
+// The code that's patched into the main loop is only executed in the mode
+// that it belongs to, so it doesn't influence the timing of Run mode.
+#define P6502_PATCHED_MODES(X) \
+    X(LOAD, 2,  /* Load data from hub to RAM */                             \
+        "jmp     #Load_Phi1",                                               \
+        "jmp     #Load_Phi2",                                               \
+        "nop",                                                              \
+        "jmp     #Restore",                                                 \
+        Load_Init)                                                          \
+    X(INIT, 3,  /* Init and reset system */                                 \
+        "jmp     #Init_Phi1",                                               \
+        "jmp     #Init_Phi2",                                               \
+        "djnz    %[clockcount], #MainLoop",                                 \
+        "jmp     #Restore",                                                 \
+        Init_Init)
+
+
 //---------------------------------------------------------------------------
 // Modes for internal function
+#define P6502_MODE_ENUM(name, value, phi1, phi2, loop, end, init) \
+    P6502_MODE_##name = value,
+
 #ifdef WORKAROUND_ISSUE60
 #define P6502_MODE_NONE (0)
 #define P6502_MODE_RUN  (1)
-#define P6502_MODE_LOAD (2)
-#define P6502_MODE_INIT (3)
 #define W60(x) _(x)
 typedef int P6502_MODE;
+enum
+{
+    P6502_PATCHED_MODES(P6502_MODE_ENUM)
+};
 #else
 typedef enum
 {
     P6502_MODE_NONE = 0,                // Used internally, do not change
     P6502_MODE_RUN,                     // Run normally
-    P6502_MODE_LOAD,                    // Load data from hub to RAM
-    P6502_MODE_INIT,                    // Init and reset system
+    P6502_PATCHED_MODES(P6502_MODE_ENUM)
     
 }   P6502_MODE;
 #define W60(x) "%[" #x "]%"
 #endif
 
 
+//---------------------------------------------------------------------------
+// Entry in the mode table in the assembler code
+//
+// The mode value is stringized directly from the list of modes so it also
+// works with the Issue 60 workaround.
+#define P6502_MODE_TABLE_ENTRY(name, value, phi1, phi2, loop, end, init) \
+"\n                 long    " _(value)          /* Mode */              \
+"\n                 " phi1                      /* Phi1 for the mode */ \
+"\n                 " phi2                      /* Phi2 for the mode */ \
+"\n                 " loop                      /* DJNZ for the mode */ \
+"\n                 " end                       /* End of the mode */   \
+"\n                 long    " #init             /* Init of the mode */
+
+
 /////////////////////////////////////////////////////////////////////////////
 // STATIC DATA
 /////////////////////////////////////////////////////////////////////////////
@@ -508,20 +576,11 @@ static p6502__control(
                     //   before entering the main loop
                     //
                     // The table ends with a mode entry for mode NONE.
+                    //
+                    // The entries are generated from the list of modes
+                    // at the top of this file; don't add them here.
 "\nInitModeTable"       
-"\n                 long    " W60(P6502_MODE_LOAD)      // Following data is for Load mode
-"\n                 jmp     #Load_Phi1"                 // Phi1 for Load mode
-"\n                 jmp     #Load_Phi2"                 // Phi2 for Load mode
-"\n                 nop"                                // DJNZ for Load mode
-"\n                 jmp     #Restore"                   // End of Load mode
-"\n                 long    Load_Init"                  // Init of Load mode
-
-"\n                 long    " W60(P6502_MODE_INIT)      // Following data is for Init mode
-"\n                 jmp     #Init_Phi1"                 // Phi1 for Init mode
-"\n                 jmp     #Init_Phi2"                 // Phi2 for Init mode
-"\n                 djnz    %[clockcount], #MainLoop"   // DJNZ for Init mode
-"\n                 jmp     #Restore"                   // End of Init mode
-"\n                 long    Init_Init"                  // Init of Init mode
+                    P6502_PATCHED_MODES(P6502_MODE_TABLE_ENTRY)
 
                     // End of mode table
 "\n                 long    " W60(P6502_MODE_NONE)
@@ -610,8 +669,14 @@ static p6502__control(
                     // disable the check at the end of the loop.
                     // In other words, if z=1 here, modify the DJNZ
                     // instructions so that the result is never written.
+                    // If the main loop only supports one way of running
+                    // (see p6502features.h), the instruction at the end of
+                    // the main loop is already what it needs to be.
+                    // The Load mode loop always needs to be patched.
 "\n                 cmp     %[clockcount], #0 wz"
+#if defined(P6502_CONTROLCOG_RUN_FOREVER) && defined(P6502_CONTROLCOG_RUN_COUNTED)
 "\n                 muxnz   LoopIns,    _mux_R"
+#endif
 "\n                 muxnz   LoopIns2,   _mux_R"
 
                     // Add the system clock to the local clock. This
@@ -832,7 +897,7 @@ static p6502__control(
 "\n     if_nc       andn    OUTA,       _mask_RAMWE"
 "\n     if_c        andn    OUTA,       _mask_RAMOE"
 
-"\n                 nop"                                // Wait for settle times
+                    RAM_NOPS                            // Wait for settle times
 "\n                 or      OUTA,       _mask_RAMWE"
 
                     // Fall through to start Phi1
@@ -1071,10 +1136,18 @@ static p6502__control(
                     // If we run without limitation, the initialization
                     // code changes the instruction so it doesn't store
                     // the result (NR), so this loops forever.
+                    // If the code was compiled for only one of those cases,
+                    // the instruction is never changed in Run mode.
 //t0=59..66
 //tn=59
 "\nLoopIns"
+#if defined(P6502_CONTROLCOG_RUN_COUNTED)
 "\n                 djnz    %[clockcount], #MainLoop"
+#elif defined(P6502_CONTROLCOG_RUN_FOREVER)
+"\n                 jmp     #MainLoop"
+#else
+#error Define P6502_CONTROLCOG_RUN_FOREVER and/or P6502_CONTROLCOG_RUN_COUNTED
+#endif
 
 
 //===========================================================================
@@ -1114,8 +1187,6 @@ static p6502__control(
     [iDELAY_MIN_INIT]       "i"         (DELAY_MAINLOOP_MINDELAY_INIT),
     [iP6502_MODE_NONE]      "i"         (P6502_MODE_NONE),
     [iP6502_MODE_RUN]       "i"         (P6502_MODE_RUN),    
-    [iP6502_MODE_LOAD]      "i"         (P6502_MODE_LOAD),
-    [iP6502_MODE_INIT]      "i"         (P6502_MODE_INIT),
     [iINS6502_CMPIMM]       "i"         (0xC9),
     [iINS6502_RTI]          "i"         (0x40)
 :
@@ -16,6 +16,7 @@
 
 
 #include "p6502features.h"
+#include "p6502_timing.h"
 #include <propeller.h>
 
 
@@ -19,6 +19,17 @@
 // Uncomment this if you need to download data to the Propeddle RAM.
 #define P6502_CONTROLCOG_DOWNLOAD
 
+// Uncomment this if you need to run the 6502 without limiting the number of
+// clock cycles (i.e. the number of clock cycles is 0).
+#define P6502_CONTROLCOG_RUN_FOREVER
+
+// Uncomment this if you need to run the 6502 for a limited number of clock
+// cycles. If this is the only one of the two that's uncommented, a clock
+// count of 0 runs the 6502 for 2^32 cycles.
+// If both are uncommented, the control cog decides at runtime. If only one of
+// them is uncommented, it doesn't need to patch the main loop for it.
+#define P6502_CONTROLCOG_RUN_COUNTED
+
 // Uncomment this if you need to shut down the control cog.
 #define P6502_CONTROLCOG_SHUTDOWN
 